@@ -1,3 +1,5 @@
+#pragma once
+
 #include <iostream>
 #include <filesystem>
 #include <random>
@@ -6,11 +8,34 @@
 #include <fstream>
 #include <ctime>
 #include <map>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <set>
+#include <sstream>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <cstdint> // For fixed-width integers
                    //
 // this header file or "library" should be either included everywhere OR
 // simply make a library with cmakelists and include it like that
 
+// Per-root record of what the last run wrote, for incremental regeneration
+#define STATE_FILE_NAME ".generator-state"
+
 // Macro for stack trace
 #define STACK_TRACE std::cerr << "Error at " << __FUNCTION__ << " (Line " << __LINE__ << ")\n"
 
@@ -31,72 +56,727 @@
 
 namespace fs = std::filesystem;
 
+// Compressor a TarWriter pipes the archive through
+enum class Compression { None, Gzip, Zstd, Xz };
+
+// Destination for generated files other than the filesystem. Paths are
+// relative to the generated root, with '/' separators, and directories
+// arrive before their contents.
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+    virtual bool addDirectory(const std::string& path, std::string& log) = 0;
+    virtual bool addFile(const std::string& path, const std::string& content, std::string& log) = 0;
+};
+
+// Streams a POSIX ustar archive into one file, optionally through an
+// external gzip, zstd or xz process. Entries go through one fixed buffer,
+// so memory use does not grow with the archive. Paths too long for the
+// ustar name and prefix fields get a pax extended header.
+class TarWriter : public OutputSink {
+private:
+    static constexpr size_t blockSize = 512;
+    static constexpr size_t bufferSize = size_t(1) << 20;
+
+    std::string archivePath;
+    std::string prefix;       // Top-level directory of every entry, may be empty
+    int fd = -1;              // The archive, or the compressor's stdin
+    pid_t compressor = -1;
+    std::vector<char> buffer;
+    size_t used = 0;
+    int64 mtime;              // Of every entry: when the writer was opened
+
+    // Writes to a compressor that has exited raise SIGPIPE. It is blocked on
+    // this thread for the duration, so they fail with EPIPE instead and the
+    // process-wide disposition is left alone.
+    bool flush(std::string& log) {
+        sigset_t pipeSignal, previousMask;
+        bool piped = compressor > 0;
+        if (piped) {
+            sigemptyset(&pipeSignal);
+            sigaddset(&pipeSignal, SIGPIPE);
+            pthread_sigmask(SIG_BLOCK, &pipeSignal, &previousMask);
+        }
+        size_t written = 0;
+        int error = 0;
+        while (written < used) {
+            ssize_t n = ::write(fd, buffer.data() + written, used - written);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                error = errno;
+                break;
+            }
+            written += static_cast<size_t>(n);
+        }
+        if (piped) {
+            // Discard the SIGPIPE the failed write left pending, unless it was blocked already
+            if (error == EPIPE && !sigismember(&previousMask, SIGPIPE)) {
+                struct timespec poll = {0, 0};
+                while (sigtimedwait(&pipeSignal, nullptr, &poll) == SIGPIPE) {
+                }
+            }
+            pthread_sigmask(SIG_SETMASK, &previousMask, nullptr);
+        }
+        if (error) {
+            log += "Error writing archive: " + archivePath + ": " + std::generic_category().message(error) + "\n";
+            return false;
+        }
+        used = 0;
+        return true;
+    }
+
+    bool append(const char* data, size_t size, std::string& log) {
+        while (size > 0) {
+            if (used == buffer.size() && !flush(log)) {
+                return false;
+            }
+            size_t n = std::min(size, buffer.size() - used);
+            std::memcpy(buffer.data() + used, data, n);
+            used += n;
+            data += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    // Zeros up to the next block boundary after `size` bytes of data
+    bool pad(size_t size, std::string& log) {
+        static const char zeros[blockSize] = {};
+        size_t rest = (blockSize - size % blockSize) % blockSize;
+        return append(zeros, rest, log);
+    }
+
+    // `width - 1` octal digits and a NUL
+    static void octal(char* field, size_t width, uint64_t value) {
+        field[width - 1] = '\0';
+        for (size_t i = width - 1; i-- > 0;) {
+            field[i] = static_cast<char>('0' + (value & 7));
+            value >>= 3;
+        }
+    }
+
+    // Splits `name` into a prefix of at most 155 bytes and a name of at
+    // most 100 at a '/', as ustar stores long paths; false if it cannot
+    static bool splitName(const std::string& name, std::string& head, std::string& tail) {
+        if (name.size() <= 100) {
+            head.clear();
+            tail = name;
+            return true;
+        }
+        for (size_t slash = name.find('/'); slash != std::string::npos && slash <= 155; slash = name.find('/', slash + 1)) {
+            if (name.size() - slash - 1 <= 100 && slash + 1 < name.size()) {
+                head = name.substr(0, slash);
+                tail = name.substr(slash + 1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool header(const std::string& name, char type, uint64_t size, std::string& log) {
+        std::string head, tail;
+        if (!splitName(name, head, tail)) {
+            // pax record "<length> path=<name>\n", the length counting itself
+            std::string record = " path=" + name + "\n";
+            size_t length = record.size() + 1;
+            while (std::to_string(length).size() + record.size() != length) {
+                ++length;
+            }
+            record = std::to_string(length) + record;
+            if (!header("PaxHeader", 'x', record.size(), log) || !append(record.data(), record.size(), log) ||
+                !pad(record.size(), log)) {
+                return false;
+            }
+            head.clear();
+            tail = name.substr(0, 100);
+        }
+        if (size >= (uint64_t(1) << 33)) {
+            log += "Error writing archive: " + name + " is 8 GiB or larger\n";
+            return false;
+        }
+
+        char block[blockSize] = {};
+        std::memcpy(block, tail.data(), tail.size());
+        octal(block + 100, 8, type == '5' ? 0755 : 0644);
+        octal(block + 108, 8, 0);
+        octal(block + 116, 8, 0);
+        octal(block + 124, 12, size);
+        octal(block + 136, 12, static_cast<uint64_t>(mtime));
+        block[156] = type;
+        std::memcpy(block + 257, "ustar", 6);
+        std::memcpy(block + 263, "00", 2);
+        std::memcpy(block + 345, head.data(), head.size());
+        // Checksum of the header with its own field read as spaces
+        std::memset(block + 148, ' ', 8);
+        unsigned sum = 0;
+        for (unsigned char c : block) {
+            sum += c;
+        }
+        octal(block + 148, 7, sum);
+        return append(block, blockSize, log);
+    }
+
+    std::string entryName(const std::string& path) const {
+        return prefix.empty() ? path : prefix + "/" + path;
+    }
+
+    bool checkOpen(std::string& log) const {
+        if (fd < 0) {
+            log += "Error writing archive: " + archivePath + " is not open\n";
+            return false;
+        }
+        return true;
+    }
+
+public:
+    explicit TarWriter(const std::string& path, Compression compression = Compression::None, const std::string& topDirectory = "")
+        : archivePath(path), prefix(topDirectory), buffer(bufferSize), mtime(static_cast<int64>(std::time(nullptr))) {
+        int out = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (out < 0 || compression == Compression::None) {
+            fd = out;
+            return;
+        }
+        int pipeFds[2];
+        if (::pipe(pipeFds) != 0) {
+            ::close(out);
+            return;
+        }
+        ::fcntl(pipeFds[1], F_SETFD, FD_CLOEXEC); // Only this process may hold the write end
+        compressor = ::fork();
+        if (compressor == 0) {
+            ::dup2(pipeFds[0], 0);
+            ::dup2(out, 1);
+            ::close(pipeFds[0]);
+            ::close(out);
+            switch (compression) {
+                case Compression::Gzip: ::execlp("gzip", "gzip", "-c", static_cast<char*>(nullptr)); break;
+                case Compression::Zstd: ::execlp("zstd", "zstd", "-q", "-c", static_cast<char*>(nullptr)); break;
+                default: ::execlp("xz", "xz", "-c", static_cast<char*>(nullptr)); break;
+            }
+            ::_exit(127);
+        }
+        ::close(pipeFds[0]);
+        ::close(out);
+        if (compressor < 0) {
+            ::close(pipeFds[1]);
+            return;
+        }
+        fd = pipeFds[1];
+    }
+
+    TarWriter(const TarWriter&) = delete;
+    TarWriter& operator=(const TarWriter&) = delete;
+
+    ~TarWriter() {
+        std::string log;
+        if (!close(log)) {
+            STACK_TRACE;
+            std::cerr << log;
+        }
+    }
+
+    bool isOpen() const {
+        return fd >= 0;
+    }
+
+    bool addDirectory(const std::string& path, std::string& log) override {
+        return checkOpen(log) && header(entryName(path) + "/", '5', 0, log);
+    }
+
+    bool addFile(const std::string& path, const std::string& content, std::string& log) override {
+        return checkOpen(log) && header(entryName(path), '0', content.size(), log) &&
+               append(content.data(), content.size(), log) && pad(content.size(), log);
+    }
+
+    // Ends the archive and waits for the compressor; called by the destructor otherwise
+    bool close(std::string& log) {
+        if (fd < 0) {
+            return compressor < 0;
+        }
+        static const char end[2 * blockSize] = {};
+        bool ok = append(end, sizeof(end), log) && flush(log);
+        ok = ::close(fd) == 0 && ok;
+        fd = -1;
+        if (compressor > 0) {
+            int status = 0;
+            while (::waitpid(compressor, &status, 0) < 0 && errno == EINTR) {
+            }
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                log += "Error compressing archive: " + archivePath + ": compressor failed\n";
+                ok = false;
+            }
+            compressor = -1;
+        }
+        return ok;
+    }
+};
+
+// Keeps generated files in memory, e.g. to check generator output in tests
+class MemoryFileSystem : public OutputSink {
+private:
+    std::map<std::string, std::string> files; // Maps path to content
+    std::set<std::string> directories;
+
+public:
+    bool addDirectory(const std::string& path, std::string&) override {
+        directories.insert(path);
+        return true;
+    }
+
+    bool addFile(const std::string& path, const std::string& content, std::string&) override {
+        files[path] = content;
+        return true;
+    }
+
+    const std::map<std::string, std::string>& getFiles() const {
+        return files;
+    }
+
+    const std::set<std::string>& getDirectories() const {
+        return directories;
+    }
+
+    // Content of the file at `path`, or nullptr
+    const std::string* read(const std::string& path) const {
+        auto found = files.find(path);
+        return found == files.end() ? nullptr : &found->second;
+    }
+};
+
+// Totals from one generate() run
+struct GenerationStats {
+    int64 files = 0;     // Files written
+    int64 skipped = 0;   // Files whose bytes were already up to date
+    int64 bytes = 0;     // Bytes written
+    int64 failed = 0;    // Files that could not be written
+    double seconds = 0;  // Wall time of the run
+};
+
+// Kinds of file a manifest can ask for
+enum class FileKind { Source, Header, Test, Fixed };
+
 template<typename T>
 class Foo {
 private:
+    // `count` generated files of one kind in `directory`, relative to the root
+    struct Category {
+        std::string directory;
+        FileKind kind;
+        int64 count;
+    };
+
+    // One file to write; the name is the class or module it is for
+    struct FileJob {
+        fs::path path;
+        std::string key;                      // Path relative to the root, as recorded in the state file
+        std::string name;
+        FileKind kind;
+        const std::string* content = nullptr; // For FileKind::Fixed
+    };
+
+    // What an earlier run left at a path
+    struct FileRecord {
+        uint64_t hash = 0;
+        uint64_t size = 0;
+        int64 mtime = 0; // Nanoseconds
+        bool valid = false;
+    };
+
     std::map<std::string, std::string> fileConfigs; // Maps filename to content
+    std::vector<Category> categories;
     std::string rootPath;
+    uint64_t seed = 0;
+    std::mt19937_64 rng; // Reseeded per category, so names only depend on seed, category and index
+    unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+    bool verbose = false;    // List every file in the summary
+    bool incremental = true; // Skip files whose bytes are unchanged
+    OutputSink* output = nullptr; // Files go to the filesystem when null
 
+    // First character from the letters only, so names are valid identifiers
     std::string generateRandomName(T length) {
         static const char alphanum[] =
             "0123456789"
             "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
             "abcdefghijklmnopqrstuvwxyz";
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<> dis(0, sizeof(alphanum) - 2); // -2 to avoid null terminator
+        std::uniform_int_distribution<int> letter(10, sizeof(alphanum) - 2); // -2 to avoid null terminator
+        std::uniform_int_distribution<int> any(0, sizeof(alphanum) - 2);
         std::string result;
         result.reserve(length);
         for (T i = 0; i < length; ++i) {
-            result += alphanum[dis(gen)];
+            result += alphanum[i == 0 ? letter(rng) : any(rng)];
         }
         return result;
     }
 
+    static std::string caseFolded(std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+        return text;
+    }
+
+    // `count` names whose files `<directory>/<name><suffix>` are new in
+    // `taken`: the classic five first, then random ones. `taken` holds
+    // case-folded paths relative to the root, so two files of one
+    // directory never differ only in case, whichever category or
+    // addFile call they came from.
+    std::vector<std::string> generateNames(size_t category, int64 count, const std::string& directory,
+                                           const std::string& suffix, std::set<std::string>& taken) {
+        static const char* fixedNames[] = {"foo", "bar", "baz", "qux", "quux"};
+        rng.seed(seed ^ ((category + 1) * 0x9E3779B97F4A7C15ull));
+        std::vector<std::string> names;
+        names.reserve(static_cast<size_t>(count));
+        for (int64 i = 0; i < count; ++i) {
+            std::string name = i < 5 ? fixedNames[i] : generateRandomName(12);
+            while (!taken.insert(caseFolded(directory + name + suffix)).second) {
+                name = generateRandomName(12); // Taken; draw again
+            }
+            names.push_back(std::move(name));
+        }
+        return names;
+    }
+
     void createDirectory(const fs::path& path) {
         try {
-            if (fs::create_directories(path)) {
-                std::cout << "Created directory: " << path << std::endl;
+            if (fs::create_directories(path) && verbose) {
+                std::cout << "Created directory: " << path << '\n';
             }
         } catch (const fs::filesystem_error& e) {
             STACK_TRACE;
-            std::cerr << "Error creating directory: " << e.what() << std::endl;
+            std::cerr << "Error creating directory: " << e.what() << '\n';
         }
     }
 
-    void createFile(const fs::path& path, const std::string& content = "") {
-        try {
-            std::ofstream file(path);
-            if (file.is_open()) {
-                file << content;
-                file.close();
-                std::cout << "Created file: " << path << std::endl;
-            } else {
-                STACK_TRACE;
-                std::cerr << "Error opening file: " << path << std::endl;
+    // Output a writer thread buffers until all writers are done
+    struct WriterLog {
+        std::string created; // Files created, when verbose
+        std::string errors;
+    };
+
+    // 64-bit FNV-1a
+    static uint64_t contentHash(const char* data, size_t size) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    static int64 modificationTime(const struct stat& st) {
+#ifdef __APPLE__
+        return static_cast<int64>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+        return static_cast<int64>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    }
+
+    // Now, in nanoseconds, on the clock file timestamps come from. Linux
+    // stamps files from the coarse clock, which trails CLOCK_REALTIME.
+    static int64 fileSystemNow() {
+        struct timespec now;
+#ifdef CLOCK_REALTIME_COARSE
+        ::clock_gettime(CLOCK_REALTIME_COARSE, &now);
+#else
+        ::clock_gettime(CLOCK_REALTIME, &now);
+#endif
+        return static_cast<int64>(now.tv_sec) * 1000000000 + now.tv_nsec;
+    }
+
+    // Git's racy-clean rule: a file stamped in or after the second its
+    // record was taken could be edited again without its mtime moving, on
+    // filesystems with coarse timestamps, so its mtime proves nothing
+    static bool racilyClean(int64 mtime, int64 recordedAt) {
+        return mtime / 1000000000 >= recordedAt / 1000000000;
+    }
+
+    // Hash of the file at `path`, read through `buffer`; false if it cannot be read
+    static bool hashFile(const fs::path& path, std::string& buffer, uint64_t& hash) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        buffer.clear();
+        char chunk[65536];
+        ssize_t n;
+        while ((n = ::read(fd, chunk, sizeof(chunk))) != 0) {
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                ::close(fd);
+                return false;
             }
-        } catch (const std::exception& e) {
-            STACK_TRACE;
-            std::cerr << "Error creating file: " << e.what() << std::endl;
+            buffer.append(chunk, static_cast<size_t>(n));
         }
+        ::close(fd);
+        hash = contentHash(buffer.data(), buffer.size());
+        return true;
     }
 
-    std::string generateFileContent(const std::string& filename, bool isHeader) {
-        std::string content;
-        content += "// File: " + filename + "\n";
-        content += "// Generated: " + std::string(std::ctime(nullptr));
+    // Writes a whole file with one open, write and close, appending any
+    // error to `log` instead of printing it
+    static bool writeFile(const fs::path& path, const std::string& content, std::string& log, int64& mtime) {
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            log += "Error opening file: " + path.string() + ": " + std::generic_category().message(errno) + "\n";
+            return false;
+        }
+        size_t written = 0;
+        while (written < content.size()) {
+            ssize_t n = ::write(fd, content.data() + written, content.size() - written);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                log += "Error writing file: " + path.string() + ": " + std::generic_category().message(errno) + "\n";
+                ::close(fd);
+                return false;
+            }
+            written += static_cast<size_t>(n);
+        }
+        struct stat st;
+        mtime = ::fstat(fd, &st) == 0 ? modificationTime(st) : 0;
+        if (::close(fd) != 0) {
+            log += "Error closing file: " + path.string() + ": " + std::generic_category().message(errno) + "\n";
+            return false;
+        }
+        return true;
+    }
+
+    // Replaces `content` with the file for `job`, reusing its capacity.
+    // Content depends only on the manifest, so reruns produce the same bytes.
+    void generateFileContent(std::string& content, const FileJob& job) const {
+        content.clear();
+        const std::string& filename = job.name;
+        if (job.kind == FileKind::Fixed) {
+            content = *job.content;
+            return;
+        }
+        if (job.kind == FileKind::Test) {
+            content += "// Test for " + filename + "\n";
+            return;
+        }
+        content += "// File: ";
+        content += filename;
+        content += "\n// Generated with seed ";
+        content += std::to_string(seed);
+        content += "\n";
 
-        if (isHeader) {
+        if (job.kind == FileKind::Header) {
             content += "#pragma once\n\n";
-            content += "class " + fs::path(filename).stem().string() + " {\n";
+            content += "class ";
+            content += fs::path(filename).stem().string();
+            content += " {\n";
             content += "public:\n";
             content += "    // Add your class definition here\n";
             content += "};\n";
         } else {
-            content += "// Implementation for " + filename + "\n";
+            content += "// Implementation for ";
+            content += filename;
+            content += "\n";
+        }
+    }
+
+    fs::path statePath() const {
+        return fs::path(rootPath) / STATE_FILE_NAME;
+    }
+
+    // Records from the last run: a "start <time>" line with the time the
+    // run started, then "<hash> <size> <mtime> <path>" per line. Without a
+    // start line, every record counts as racily clean.
+    std::unordered_map<std::string, FileRecord> loadState(int64& started) const {
+        std::unordered_map<std::string, FileRecord> records;
+        std::ifstream in(statePath());
+        std::string line;
+        started = INT64_MIN;
+        while (std::getline(in, line)) {
+            if (line.compare(0, 6, "start ") == 0) {
+                std::from_chars(line.data() + 6, line.data() + line.size(), started);
+                continue;
+            }
+            std::istringstream fields(line);
+            FileRecord record;
+            std::string key;
+            if (fields >> std::hex >> record.hash >> std::dec >> record.size >> record.mtime && fields.get() == ' ' &&
+                std::getline(fields, key)) {
+                record.valid = true;
+                records[key] = record;
+            }
+        }
+        return records;
+    }
+
+    // Replaces the state file, through a rename so a crash leaves the old one
+    void saveState(const std::vector<FileJob>& jobs, const std::vector<FileRecord>& records, int64 started) const {
+        std::string text = "start " + std::to_string(started) + "\n";
+        char fields[64];
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            if (!records[i].valid) {
+                continue;
+            }
+            std::snprintf(fields, sizeof(fields), "%016llx %llu %lld ", static_cast<unsigned long long>(records[i].hash),
+                          static_cast<unsigned long long>(records[i].size), static_cast<long long>(records[i].mtime));
+            text += fields;
+            text += jobs[i].key;
+            text += '\n';
+        }
+        fs::path temporary = statePath();
+        temporary += ".tmp";
+        std::string log;
+        int64 mtime;
+        std::error_code error;
+        if (!writeFile(temporary, text, log, mtime) || (fs::rename(temporary, statePath(), error), error)) {
+            STACK_TRACE;
+            std::cerr << "Error saving generator state: " << (log.empty() ? error.message() : log) << '\n';
+        }
+    }
+
+    // Writes every job from `threadCount` threads, which claim chunks of
+    // jobs from a shared counter. Each thread keeps one content buffer
+    // and one log; logs are printed once all threads are done. Files
+    // whose bytes already match are left alone: a file with the size and
+    // mtime recorded last run is trusted to still hold the recorded hash
+    // unless that record is racily clean; any other existing file of the
+    // right size is read and hashed.
+    GenerationStats writeJobs(const std::vector<FileJob>& jobs) {
+        int64 previousStart = INT64_MIN;
+        const std::unordered_map<std::string, FileRecord> previous =
+            incremental ? loadState(previousStart) : std::unordered_map<std::string, FileRecord>();
+        const int64 started = fileSystemNow();
+        std::vector<FileRecord> records(jobs.size());
+        const size_t chunk = 64;
+        std::atomic<size_t> next{0};
+        std::atomic<int64> files{0}, skipped{0}, bytes{0}, failed{0};
+        unsigned workers = static_cast<unsigned>(std::min<size_t>(threadCount, (jobs.size() + chunk - 1) / chunk));
+        std::vector<WriterLog> logs(std::max(1u, workers));
+
+        auto work = [&](WriterLog& log) {
+            std::string content, existing;
+            int64 localFiles = 0, localSkipped = 0, localBytes = 0, localFailed = 0;
+            for (size_t begin = next.fetch_add(chunk); begin < jobs.size(); begin = next.fetch_add(chunk)) {
+                size_t end = std::min(begin + chunk, jobs.size());
+                for (size_t i = begin; i < end; ++i) {
+                    const FileJob& job = jobs[i];
+                    generateFileContent(content, job);
+                    FileRecord& record = records[i];
+                    record.hash = contentHash(content.data(), content.size());
+                    record.size = content.size();
+
+                    struct stat st;
+                    if (incremental && ::stat(job.path.c_str(), &st) == 0 &&
+                        static_cast<uint64_t>(st.st_size) == record.size) {
+                        auto found = previous.find(job.key);
+                        bool recorded = found != previous.end() && found->second.hash == record.hash &&
+                                        found->second.size == record.size && found->second.mtime == modificationTime(st) &&
+                                        !racilyClean(found->second.mtime, previousStart);
+                        uint64_t hash;
+                        if (recorded || (hashFile(job.path, existing, hash) && hash == record.hash)) {
+                            record.mtime = modificationTime(st);
+                            record.valid = true;
+                            ++localSkipped;
+                            continue;
+                        }
+                    }
+
+                    if (writeFile(job.path, content, log.errors, record.mtime)) {
+                        record.valid = true;
+                        ++localFiles;
+                        localBytes += static_cast<int64>(content.size());
+                        if (verbose) {
+                            log.created += "Created file: " + job.path.string() + "\n";
+                        }
+                    } else {
+                        ++localFailed;
+                    }
+                }
+            }
+            files += localFiles;
+            skipped += localSkipped;
+            bytes += localBytes;
+            failed += localFailed;
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (unsigned t = 1; t < workers; ++t) {
+            threads.emplace_back(work, std::ref(logs[t]));
+        }
+        work(logs[0]);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        if (incremental) {
+            saveState(jobs, records, started);
         }
 
-        return content;
+        GenerationStats stats;
+        stats.files = files;
+        stats.skipped = skipped;
+        stats.bytes = bytes;
+        stats.failed = failed;
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (const auto& log : logs) {
+            std::cout << log.created;
+            std::cerr << log.errors;
+        }
+        return stats;
+    }
+
+    // Hands every job to `output` in order, on this thread. Only one
+    // content buffer is live, so a TarWriter streams in constant memory.
+    GenerationStats writeToSink(const std::vector<FileJob>& jobs) {
+        auto start = std::chrono::steady_clock::now();
+        GenerationStats stats;
+        std::string content;
+        WriterLog log;
+        for (const FileJob& job : jobs) {
+            generateFileContent(content, job);
+            if (output->addFile(job.key, content, log.errors)) {
+                ++stats.files;
+                stats.bytes += static_cast<int64>(content.size());
+                if (verbose) {
+                    log.created += "Added file: " + job.key + "\n";
+                }
+            } else {
+                ++stats.failed;
+            }
+        }
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << log.created;
+        std::cerr << log.errors;
+        return stats;
+    }
+
+    static const char* suffixOf(FileKind kind) {
+        switch (kind) {
+            case FileKind::Source: return ".cpp";
+            case FileKind::Header: return ".hpp";
+            case FileKind::Test: return "_test.cpp";
+            default: return "";
+        }
+    }
+
+    // Relative paths that stay under the root: no root name or directory
+    // (which would replace the root when appended to it) and no ".."
+    static bool staysUnderRoot(const std::string& path) {
+        fs::path relative(path);
+        if (relative.has_root_path()) {
+            return false;
+        }
+        for (const fs::path& part : relative) {
+            if (part == "..") {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static const char* directoryOf(FileKind kind) {
+        switch (kind) {
+            case FileKind::Source: return "src";
+            case FileKind::Header: return "inc";
+            default: return "tests";
+        }
     }
 
 public:
@@ -104,41 +784,206 @@ public:
         rootPath = path;
     }
 
-    void addFile(const std::string& name, const std::string& content) {
+    // Files written as given, at paths relative to the root. Absolute
+    // paths and paths through ".." are rejected.
+    bool addFile(const std::string& name, const std::string& content) {
+        if (!staysUnderRoot(name)) {
+            STACK_TRACE;
+            std::cerr << "Error adding file: " << name << " is not a path under the root" << '\n';
+            return false;
+        }
         fileConfigs[name] = content;
+        return true;
     }
 
-    void generate(T numSrcFiles, T numIncFiles, T numTestFiles) {
-        // Convert rootPath to std::filesystem::path explicitly
-        fs::path rootDir = fs::path(rootPath);
+    // Adds `count` generated files of `kind` under `directory`, which like
+    // addFile's names must be relative and free of ".."
+    bool addCategory(const std::string& directory, FileKind kind, int64 count) {
+        if (kind == FileKind::Fixed) {
+            STACK_TRACE;
+            std::cerr << "Fixed files are added with addFile" << '\n';
+            return false;
+        }
+        if (!staysUnderRoot(directory)) {
+            STACK_TRACE;
+            std::cerr << "Error adding category: " << directory << " is not a directory under the root" << '\n';
+            return false;
+        }
+        categories.push_back({directory, kind, std::max<int64>(count, 0)});
+        return true;
+    }
 
-        // Create root directories
-        fs::path srcPath = rootDir / "src";
-        fs::path incPath = rootDir / "inc";
-        fs::path testPath = rootDir / "tests";
+    // Generated names depend only on the seed, so reruns target the same files
+    void setSeed(uint64_t value) {
+        seed = value;
+    }
 
-        createDirectory(srcPath);
-        createDirectory(incPath);
-        createDirectory(testPath);
+    // Threads writing files; 1 writes everything on the calling thread
+    void setThreads(unsigned threads) {
+        threadCount = std::max(1u, threads);
+    }
+
+    // Lists every created file and directory in the output
+    void setVerbose(bool enabled) {
+        verbose = enabled;
+    }
+
+    // When off, every file is rewritten and no state file is kept
+    void setIncremental(bool enabled) {
+        incremental = enabled;
+    }
+
+    // Sends files to `sink` (a TarWriter or MemoryFileSystem) instead of
+    // the filesystem, or back to the filesystem for nullptr. The sink is
+    // not owned. Sinks receive every file, in order, from one thread.
+    void setOutput(OutputSink* sink) {
+        output = sink;
+    }
 
-        // Generate source files
-        std::vector<std::string> names = {"foo", "bar", "baz", "qux", "quux"};
-        for (T i = 0; i < numSrcFiles && i < names.size(); ++i) { // Ensure bounds check
-            fs::path filePath = srcPath / (names[i] + ".cpp");
-            createFile(filePath, generateFileContent(names[i], false));
+    // Reads a manifest of one entry per line, '#' starting a comment:
+    //
+    //   seed 42
+    //   source src 100000
+    //   header inc/core 5000
+    //   test tests 200
+    //
+    // Seeds and counts are non-negative integers and a line holds
+    // nothing after them. Directories are relative to the root and may
+    // not leave it.
+    bool loadManifest(const std::string& path) {
+        std::ifstream in(path);
+        if (!in) {
+            STACK_TRACE;
+            std::cerr << "Error opening manifest: " << path << '\n';
+            return false;
         }
+        std::string line;
+        for (int32 number = 1; std::getline(in, line); ++number) {
+            line = line.substr(0, line.find('#'));
+            std::istringstream fields(line);
+            std::string keyword, directory, value, extra;
+            int64 count;
+            if (!(fields >> keyword)) {
+                continue;
+            }
+            if (keyword == "seed") {
+                // Digits only: extraction into uint64_t would wrap "-1"
+                fields >> value;
+                uint64_t parsed;
+                auto result = std::from_chars(value.data(), value.data() + value.size(), parsed);
+                if (result.ec == std::errc() && result.ptr == value.data() + value.size() && !(fields >> extra)) {
+                    seed = parsed;
+                    continue;
+                }
+            } else if (fields >> directory >> count && count >= 0 && !(fields >> extra)) {
+                if (keyword == "source" && addCategory(directory, FileKind::Source, count)) {
+                    continue;
+                }
+                if (keyword == "header" && addCategory(directory, FileKind::Header, count)) {
+                    continue;
+                }
+                if (keyword == "test" && addCategory(directory, FileKind::Test, count)) {
+                    continue;
+                }
+            }
+            STACK_TRACE;
+            std::cerr << "Error in manifest " << path << " line " << number << ": " << line << '\n';
+            return false;
+        }
+        return true;
+    }
 
-        // Generate header files
-        for (T i = 0; i < numIncFiles && i < names.size(); ++i) { // Ensure bounds check
-            fs::path filePath = incPath / (names[i] + ".hpp");
-            createFile(filePath, generateFileContent(names[i], true));
+    // Generates every category and added file. Categories sharing a
+    // directory draw distinct names, and generated names avoid the
+    // paths of added files; added files whose paths are the same up to
+    // case are reported and all but the first skipped.
+    GenerationStats generate() {
+        // Convert rootPath to std::filesystem::path explicitly
+        fs::path rootDir = fs::path(rootPath);
+
+        // Directories relative to the root, parents included, so they sort before their contents
+        std::vector<FileJob> jobs;
+        std::set<std::string> directories;
+        auto addDirectories = [&](fs::path relative) {
+            for (relative = relative.lexically_normal(); !relative.empty() && relative.has_filename();
+                 relative = relative.parent_path()) {
+                directories.insert(relative.generic_string());
+            }
+        };
+        std::set<std::string> taken; // Case-folded paths of every job
+        std::vector<FileJob> fixedJobs;
+        int64 rejected = 0;
+        for (const auto& [name, content] : fileConfigs) {
+            std::string key = fs::path(name).lexically_normal().generic_string();
+            if (!taken.insert(caseFolded(key)).second) {
+                STACK_TRACE;
+                std::cerr << "Error adding file: " << name << " duplicates the path of another file, skipped" << '\n';
+                ++rejected;
+                continue;
+            }
+            addDirectories(fs::path(name).parent_path());
+            fixedJobs.push_back({rootDir / key, key, name, FileKind::Fixed, &content});
         }
+        for (size_t c = 0; c < categories.size(); ++c) {
+            const Category& category = categories[c];
+            std::string directory = fs::path(category.directory).lexically_normal().generic_string();
+            if (directory == ".") {
+                directory.clear();
+            } else if (!directory.empty() && directory.back() != '/') {
+                directory += '/';
+            }
+            addDirectories(category.directory);
+            const char* suffix = suffixOf(category.kind);
+            for (const std::string& name : generateNames(c, category.count, directory, suffix, taken)) {
+                std::string key = directory + name + suffix;
+                jobs.push_back({rootDir / key, key, name, category.kind});
+            }
+        }
+        jobs.insert(jobs.end(), fixedJobs.begin(), fixedJobs.end());
 
-        // Generate test files
-        for (T i = 0; i < numTestFiles && i < names.size(); ++i) { // Ensure bounds check
-            fs::path filePath = testPath / (names[i] + "_test.cpp");
-            createFile(filePath, "// Test for " + names[i] + "\n");
+        GenerationStats stats;
+        if (output) {
+            std::string log;
+            for (const std::string& directory : directories) {
+                if (!output->addDirectory(directory, log)) {
+                    ++stats.failed;
+                }
+            }
+            std::cerr << log;
+            if (stats.failed) {
+                stats.failed += rejected;
+                return stats;
+            }
+            stats = writeToSink(jobs);
+        } else {
+            createDirectory(rootDir); // Added files may all sit directly in the root
+            for (const std::string& directory : directories) {
+                createDirectory(rootDir / directory);
+            }
+            stats = writeJobs(jobs);
         }
+        stats.failed += rejected;
+        if (output) {
+            // One writer and no incremental skipping when streaming to a sink
+            std::cout << "Added " << stats.files << " files (" << stats.bytes << " bytes) to the output in "
+                      << stats.seconds * 1000.0 << " ms";
+        } else {
+            std::cout << "Generated " << stats.files << " files (" << stats.bytes << " bytes), " << stats.skipped
+                      << " unchanged, in " << stats.seconds * 1000.0 << " ms with up to " << threadCount << " threads";
+        }
+        if (stats.failed) {
+            std::cout << ", " << stats.failed << " failed";
+        }
+        std::cout << std::endl;
+        return stats;
     }
-};
 
+    // Source, header and test files under src, inc and tests
+    GenerationStats generate(T numSrcFiles, T numIncFiles, T numTestFiles) {
+        categories.clear();
+        addCategory(directoryOf(FileKind::Source), FileKind::Source, static_cast<int64>(numSrcFiles));
+        addCategory(directoryOf(FileKind::Header), FileKind::Header, static_cast<int64>(numIncFiles));
+        addCategory(directoryOf(FileKind::Test), FileKind::Test, static_cast<int64>(numTestFiles));
+        return generate();
+    }
+};
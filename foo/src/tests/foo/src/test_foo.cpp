@@ -0,0 +1,215 @@
+#include "../inc/foo.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+
+// Checks the file generator end to end in a scratch directory: incremental
+// reruns (racily clean edits among them), the tar writer's pax long paths,
+// that a MemoryFileSystem receives exactly what a filesystem run writes,
+// and that manifests and added files cannot write outside the root.
+
+static std::string readFile(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static bool expect(bool passed, const char* what) {
+    if (!passed) {
+        std::cout << "Generator check failed: " << what << std::endl;
+    }
+    return passed;
+}
+
+// A generator with a few categories, an added file and a shared directory
+static void configure(Foo<int>& generator, const fs::path& root) {
+    generator.setRootPath(root.string());
+    generator.setSeed(7);
+    generator.setThreads(3);
+    generator.addCategory("src", FileKind::Source, 150);
+    generator.addCategory("src", FileKind::Source, 20);
+    generator.addCategory("inc/core", FileKind::Header, 40);
+    generator.addCategory("tests", FileKind::Test, 10);
+    generator.addFile("README.txt", "Generated tree\n");
+}
+
+// A second run writes nothing; a file changed in place or resized is
+// rewritten, and only that file
+static bool checkIncremental(const fs::path& root) {
+    bool ok = true;
+    Foo<int> generator;
+    configure(generator, root);
+    GenerationStats first = generator.generate();
+    ok &= expect(first.files == 221 && first.skipped == 0 && first.failed == 0, "first run writes every file");
+
+    GenerationStats second = generator.generate();
+    ok &= expect(second.files == 0 && second.skipped == first.files, "rerun skips every file");
+
+    fs::path edited = root / "src" / "foo.cpp";
+    std::string original = readFile(edited);
+    std::string sameSize = original;
+    sameSize[0] = sameSize[0] == 'x' ? 'y' : 'x';
+    std::ofstream(edited, std::ios::binary | std::ios::trunc) << sameSize;
+    GenerationStats third = generator.generate();
+    ok &= expect(third.files == 1 && third.skipped == first.files - 1, "same-size edit is rewritten");
+    ok &= expect(readFile(edited) == original, "same-size edit is restored");
+
+    std::ofstream(edited, std::ios::binary | std::ios::app) << "// local change\n";
+    GenerationStats fourth = generator.generate();
+    ok &= expect(fourth.files == 1 && readFile(edited) == original, "resized file is rewritten");
+    return ok;
+}
+
+// An edit that keeps the size and mtime the file was written with, as one
+// within the same timestamp tick would, is still found and repaired
+static bool checkRacyEdit(const fs::path& root) {
+    Foo<int> generator;
+    configure(generator, root);
+    generator.generate();
+
+    fs::path edited = root / "src" / "foo.cpp";
+    std::string original = readFile(edited);
+    fs::file_time_type written = fs::last_write_time(edited);
+    std::string sameSize = original;
+    sameSize[0] = sameSize[0] == 'x' ? 'y' : 'x';
+    std::ofstream(edited, std::ios::binary | std::ios::trunc) << sameSize;
+    fs::last_write_time(edited, written);
+
+    GenerationStats rerun = generator.generate();
+    bool ok = expect(rerun.files == 1 && readFile(edited) == original, "racily clean edit is rewritten");
+    GenerationStats settled = generator.generate();
+    ok &= expect(settled.files == 0 && settled.failed == 0, "rerun after the repair writes nothing");
+    return ok;
+}
+
+// Reads a ustar archive back: every regular file, keyed by its path, with
+// pax 'path' records applied to the entry that follows them
+static bool readTar(const std::string& archive, std::map<std::string, std::string>& files) {
+    std::string data = readFile(archive);
+    std::string paxPath;
+    for (size_t at = 0; at + 512 <= data.size();) {
+        const char* block = data.data() + at;
+        if (block[0] == '\0') {
+            return true; // End-of-archive blocks
+        }
+        size_t size = std::stoull(std::string(block + 124, 11), nullptr, 8);
+        std::string content = data.substr(at + 512, size);
+        at += 512 + (size + 511) / 512 * 512;
+        if (block[156] == 'x') {
+            size_t key = content.find(" path=");
+            if (key == std::string::npos || content.back() != '\n') {
+                return false;
+            }
+            paxPath = content.substr(key + 6, content.size() - key - 7);
+            continue;
+        }
+        std::string name(block, strnlen(block, 100));
+        std::string prefix(block + 345, strnlen(block + 345, 155));
+        std::string path = !paxPath.empty() ? paxPath : prefix.empty() ? name : prefix + "/" + name;
+        paxPath.clear();
+        if (block[156] == '0') {
+            files[path] = content;
+        }
+    }
+    return false;
+}
+
+// Paths that fit ustar's name field, its prefix/name split, and neither
+static bool checkTarLongPaths(const fs::path& scratch) {
+    std::string archive = (scratch / "long.tar").string();
+    std::string split = std::string(120, 'd') + "/" + std::string(90, 'f') + ".cpp";
+    std::string unsplittable = std::string(60, 'a') + "/" + std::string(160, 'b') + ".hpp";
+    std::string log;
+    {
+        TarWriter writer(archive, Compression::None, "root");
+        bool written = writer.addFile("short.cpp", "short\n", log) && writer.addFile(split, "split\n", log) &&
+                       writer.addFile(unsplittable, std::string(1500, 'z'), log) && writer.close(log);
+        if (!expect(written, "archive is written")) {
+            std::cout << log;
+            return false;
+        }
+    }
+    std::map<std::string, std::string> files;
+    bool ok = expect(readTar(archive, files), "archive reads back");
+    ok &= expect(files.size() == 3, "archive holds every file");
+    ok &= expect(files["root/short.cpp"] == "short\n", "short path round-trips");
+    ok &= expect(files["root/" + split] == "split\n", "prefix/name path round-trips");
+    ok &= expect(files["root/" + unsplittable] == std::string(1500, 'z'), "pax path round-trips");
+    return ok;
+}
+
+// Manifest directories and added files may not leave the root, whether
+// through ".." or by being absolute
+static bool checkPathsStayUnderRoot(const fs::path& scratch) {
+    fs::path root = scratch / "contained";
+    fs::path manifest = scratch / "escape.txt";
+    bool ok = true;
+    for (const char* directory : {"../escaped", "src/../../escaped", "/etc"}) {
+        std::ofstream(manifest, std::ios::trunc) << "source src 2\nsource " << directory << " 2\n";
+        Foo<int> generator;
+        generator.setRootPath(root.string());
+        ok &= expect(!generator.loadManifest(manifest.string()), "manifest directory outside the root is rejected");
+    }
+
+    Foo<int> generator;
+    generator.setRootPath(root.string());
+    ok &= expect(!generator.addCategory("../escaped", FileKind::Source, 2), "category outside the root is rejected");
+    ok &= expect(!generator.addFile("../escaped.txt", "x"), "file through .. is rejected");
+    ok &= expect(!generator.addFile((scratch / "escaped.txt").string(), "x"), "absolute file is rejected");
+    ok &= expect(generator.addFile("inside.txt", "x"), "file under the root is accepted");
+    generator.setIncremental(false);
+    GenerationStats stats = generator.generate();
+    ok &= expect(stats.files == 1 && stats.failed == 0, "only the accepted file is written");
+    ok &= expect(!fs::exists(scratch / "escaped") && !fs::exists(scratch / "escaped.txt"), "nothing is written outside the root");
+    return ok;
+}
+
+// The same configuration into memory and onto disk gives the same tree
+static bool checkMemoryMatchesFilesystem(const fs::path& root) {
+    Foo<int> onDisk;
+    configure(onDisk, root);
+    onDisk.setIncremental(false);
+    onDisk.generate();
+
+    MemoryFileSystem memory;
+    Foo<int> inMemory;
+    configure(inMemory, root);
+    inMemory.setOutput(&memory);
+    GenerationStats stats = inMemory.generate();
+
+    std::map<std::string, std::string> written;
+    std::set<std::string> directories;
+    for (const auto& entry : fs::recursive_directory_iterator(root)) {
+        std::string relative = fs::relative(entry.path(), root).generic_string();
+        if (entry.is_directory()) {
+            directories.insert(relative);
+        } else if (relative != STATE_FILE_NAME) {
+            written[relative] = readFile(entry.path());
+        }
+    }
+    bool ok = expect(stats.failed == 0 && stats.files == static_cast<int64>(memory.getFiles().size()), "sink run adds every file");
+    ok &= expect(memory.getFiles() == written, "memory files match the filesystem");
+    ok &= expect(memory.getDirectories() == directories, "memory directories match the filesystem");
+    return ok;
+}
+
+int main() {
+    fs::path scratch = fs::temp_directory_path() / ("foo_test_" + std::to_string(::getpid()));
+    fs::remove_all(scratch);
+    fs::create_directories(scratch);
+
+    bool ok = checkIncremental(scratch / "incremental");
+    ok &= checkRacyEdit(scratch / "racy");
+    ok &= checkTarLongPaths(scratch);
+    ok &= checkMemoryMatchesFilesystem(scratch / "memory");
+    ok &= checkPathsStayUnderRoot(scratch);
+
+    fs::remove_all(scratch);
+    if (!ok) {
+        return 1;
+    }
+    std::cout << "Generator reruns, archives, memory output and path checks pass" << std::endl;
+    return 0;
+}
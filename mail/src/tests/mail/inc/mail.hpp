@@ -0,0 +1,337 @@
+#pragma once
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <mutex>
+#include <map>
+#include <memory>
+#include <boost/asio.hpp>
+
+#define SERVER_PORT 2525
+#define MAX_BUFFER_SIZE 1024
+
+using namespace boost::asio;
+using ip::tcp;
+using ip::udp;
+
+// Limits applied by MailServer<tcp> so overload degrades predictably
+struct MailServerLimits
+{
+    size_t maxConnections = 1024;                     // Concurrent TCP sessions
+    double connectionsPerSecondPerIP = 50.0;          // Sustained accept rate per client address
+    double connectionBurstPerIP = 100.0;              // Accepts allowed before the rate applies
+    size_t maxQueuedBytesPerSession = 64 * 1024;      // Outbound bytes before a session stops reading
+    size_t maxQueuedBytesTotal = 16 * 1024 * 1024;    // Outbound bytes across all sessions
+};
+
+// Reply sent to connections that are refused, then the socket is closed
+#define TEMPORARY_FAILURE_REPLY "421 4.3.2 Service temporarily unavailable, try again later\r\n"
+
+// Tracks live sessions, per-address accept rates and queued bytes.
+// Shared by all sessions of one server, so every method locks.
+class AdmissionControl
+{
+public:
+    explicit AdmissionControl(const MailServerLimits &limits) : limits_(limits) {}
+
+    // Returns false if the connection should get TEMPORARY_FAILURE_REPLY
+    bool admit(const ip::address &address)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (activeConnections_ >= limits_.maxConnections)
+        {
+            return false;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (buckets_.size() > limits_.maxConnections * 4)
+        {
+            pruneBuckets(now);
+        }
+        auto it = buckets_.find(address);
+        if (it == buckets_.end())
+        {
+            it = buckets_.emplace(address, Bucket{limits_.connectionBurstPerIP, now}).first;
+        }
+        Bucket &bucket = it->second;
+        refill(bucket, now);
+        if (bucket.tokens < 1.0)
+        {
+            return false;
+        }
+        bucket.tokens -= 1.0;
+        ++activeConnections_;
+        return true;
+    }
+
+    void release()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --activeConnections_;
+    }
+
+    void addQueued(size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queuedBytes_ += bytes;
+    }
+
+    void removeQueued(size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queuedBytes_ -= bytes;
+    }
+
+    bool saturated() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return queuedBytes_ >= limits_.maxQueuedBytesTotal;
+    }
+
+    const MailServerLimits &limits() const { return limits_; }
+
+private:
+    struct Bucket
+    {
+        double tokens;
+        std::chrono::steady_clock::time_point updated;
+    };
+
+    void refill(Bucket &bucket, std::chrono::steady_clock::time_point now)
+    {
+        double elapsed = std::chrono::duration<double>(now - bucket.updated).count();
+        bucket.tokens = std::min(limits_.connectionBurstPerIP,
+                                 bucket.tokens + elapsed * limits_.connectionsPerSecondPerIP);
+        bucket.updated = now;
+    }
+
+    // Drop addresses whose bucket has refilled, they carry no state
+    void pruneBuckets(std::chrono::steady_clock::time_point now)
+    {
+        for (auto it = buckets_.begin(); it != buckets_.end();)
+        {
+            refill(it->second, now);
+            it = it->second.tokens >= limits_.connectionBurstPerIP ? buckets_.erase(it) : std::next(it);
+        }
+    }
+
+    MailServerLimits limits_;
+    mutable std::mutex mutex_;
+    std::map<ip::address, Bucket> buckets_;
+    size_t activeConnections_ = 0;
+    size_t queuedBytes_ = 0;
+};
+
+// Echo session with a bounded outbound queue. Reading pauses while the
+// session's own queue or the server-wide budget is full and resumes as
+// writes drain. All handlers run on the socket's strand.
+class TCPSession : public std::enable_shared_from_this<TCPSession>
+{
+public:
+    TCPSession(tcp::socket socket, std::shared_ptr<AdmissionControl> admission, bool verbose)
+        : socket_(std::move(socket)), resumeTimer_(socket_.get_executor()),
+          admission_(std::move(admission)), verbose_(verbose)
+    {
+    }
+
+    ~TCPSession()
+    {
+        admission_->removeQueued(queuedBytes_);
+        admission_->release();
+    }
+
+    void start()
+    {
+        read();
+    }
+
+private:
+    bool canRead() const
+    {
+        return queuedBytes_ < admission_->limits().maxQueuedBytesPerSession && !admission_->saturated();
+    }
+
+    void read()
+    {
+        if (!canRead())
+        {
+            // Writes resume us when our own queue drains; the timer covers
+            // the case where only the server-wide budget is exhausted.
+            if (outbound_.empty())
+            {
+                auto self = shared_from_this();
+                resumeTimer_.expires_after(std::chrono::milliseconds(5));
+                resumeTimer_.async_wait([this, self](const boost::system::error_code &error) {
+                    if (!error)
+                    {
+                        read();
+                    }
+                });
+            }
+            return;
+        }
+
+        reading_ = true;
+        auto self = shared_from_this();
+        socket_.async_read_some(boost::asio::buffer(data_), [this, self](const boost::system::error_code &error, std::size_t length) {
+            reading_ = false;
+            if (error)
+            {
+                closed_ = true;
+                return; // EOF or reset, pending writes keep the session alive
+            }
+            if (verbose_)
+            {
+                std::cout << "Received TCP message: " << std::string(data_, length) << std::endl;
+            }
+            // Echo back the message
+            outbound_.emplace_back(data_, length);
+            queuedBytes_ += length;
+            admission_->addQueued(length);
+            if (!writing_)
+            {
+                write();
+            }
+            read();
+        });
+    }
+
+    void write()
+    {
+        writing_ = true;
+        auto self = shared_from_this();
+        boost::asio::async_write(socket_, boost::asio::buffer(outbound_.front()), [this, self](const boost::system::error_code &error, std::size_t length) {
+            writing_ = false;
+            if (error)
+            {
+                closed_ = true;
+                return;
+            }
+            outbound_.pop_front();
+            queuedBytes_ -= length;
+            admission_->removeQueued(length);
+            if (!outbound_.empty())
+            {
+                write();
+            }
+            if (!reading_ && !closed_)
+            {
+                read();
+            }
+        });
+    }
+
+    tcp::socket socket_;
+    steady_timer resumeTimer_;
+    std::shared_ptr<AdmissionControl> admission_;
+    char data_[MAX_BUFFER_SIZE];
+    std::deque<std::string> outbound_;
+    size_t queuedBytes_ = 0;
+    bool reading_ = false;
+    bool writing_ = false;
+    bool closed_ = false;
+    bool verbose_;
+};
+
+// Template for a generic server class, specialized per protocol below
+
+template <typename ProtocolType>
+class MailServer;
+
+// Specialization for TCP
+
+template <>
+class MailServer<tcp>
+{
+public:
+    MailServer(io_service &ioService, unsigned short port, bool verbose = true, const MailServerLimits &limits = {})
+        : ioService_(ioService), acceptor_(ioService, tcp::endpoint(tcp::v4(), port)),
+          admission_(std::make_shared<AdmissionControl>(limits)), verbose_(verbose)
+    {
+        start();
+    }
+
+private:
+    void start();
+    void reject(tcp::socket socket);
+
+    io_service &ioService_;
+    tcp::acceptor acceptor_;
+    std::shared_ptr<AdmissionControl> admission_;
+    bool verbose_;
+};
+
+inline void MailServer<tcp>::start()
+{
+    acceptor_.async_accept(make_strand(ioService_), [this](const boost::system::error_code &error, tcp::socket socket) {
+        if (!error)
+        {
+            boost::system::error_code ignored;
+            auto peer = socket.remote_endpoint(ignored);
+            if (!ignored && admission_->admit(peer.address()))
+            {
+                std::make_shared<TCPSession>(std::move(socket), admission_, verbose_)->start();
+            }
+            else
+            {
+                reject(std::move(socket));
+            }
+        }
+        start();
+    });
+}
+
+// Refused connections get a short reply instead of waiting in the backlog
+inline void MailServer<tcp>::reject(tcp::socket socket)
+{
+    auto rejected = std::make_shared<tcp::socket>(std::move(socket));
+    boost::asio::async_write(*rejected, boost::asio::buffer(TEMPORARY_FAILURE_REPLY, sizeof(TEMPORARY_FAILURE_REPLY) - 1),
+                             [rejected](const boost::system::error_code &, std::size_t) {
+                                 boost::system::error_code ignored;
+                                 rejected->shutdown(tcp::socket::shutdown_both, ignored);
+                                 rejected->close(ignored);
+                             });
+}
+
+// Specialization for UDP
+
+template <>
+class MailServer<udp>
+{
+public:
+    MailServer(io_service &ioService, unsigned short port, bool verbose = true)
+        : socket_(ioService, udp::endpoint(udp::v4(), port)), verbose_(verbose)
+    {
+        start();
+    }
+
+private:
+    void start();
+
+    udp::socket socket_;
+    udp::endpoint senderEndpoint_;
+    char data_[MAX_BUFFER_SIZE];
+    bool verbose_;
+};
+
+inline void MailServer<udp>::start()
+{
+    socket_.async_receive_from(
+        boost::asio::buffer(data_, MAX_BUFFER_SIZE), senderEndpoint_,
+        [this](const boost::system::error_code &error, std::size_t bytesReceived) {
+            if (!error)
+            {
+                if (verbose_)
+                {
+                    std::cout << "Received UDP message" << std::endl;
+                }
+                // Echo the datagram back so senders can measure round trips
+                boost::system::error_code ignored;
+                socket_.send_to(boost::asio::buffer(data_, bytesReceived), senderEndpoint_, 0, ignored);
+            }
+            start();
+        });
+}
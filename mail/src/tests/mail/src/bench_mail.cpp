@@ -0,0 +1,442 @@
+#include "../inc/mail.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Loopback benchmark for MailServer<tcp> and MailServer<udp>.
+//
+// The server runs in a forked child so its CPU time can be read back with
+// wait4() independently of the load generator. Every message carries its
+// send timestamp in the first 8 bytes, so round-trip latency is measured
+// from the echoed payload without any per-message bookkeeping.
+//
+// All clients share the loopback address, so the server's admission limits
+// are raised to fit --connections plus the startup probe. A client the
+// server still refuses reports the 421 reply instead of failing mid-read.
+//
+// Usage: bench_mail [--proto tcp|udp] [--connections N] [--size BYTES]
+//                   [--depth N] [--messages N] [--port PORT]
+
+#define BENCH_PORT (SERVER_PORT + 100)
+#define MIN_MESSAGE_SIZE 8
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchConfig
+{
+    std::string proto = "tcp";
+    size_t connections = 4;
+    size_t size = 64;
+    size_t depth = 1;
+    size_t messages = 100000; // Per connection
+    unsigned short port = BENCH_PORT;
+};
+
+struct BenchResult
+{
+    std::vector<uint64_t> latencies; // Round trips in nanoseconds
+    uint64_t bytes = 0;
+    uint64_t lost = 0;
+    bool rejected = false; // Server answered TEMPORARY_FAILURE_REPLY or closed the connection
+};
+
+static uint64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+static void stampMessage(char *message)
+{
+    uint64_t ts = nowNs();
+    std::memcpy(message, &ts, sizeof(ts));
+}
+
+static uint64_t elapsedSince(const char *message)
+{
+    uint64_t ts;
+    std::memcpy(&ts, message, sizeof(ts));
+    return nowNs() - ts;
+}
+
+// True if the first bytes read on a connection are the server's refusal
+static bool isTemporaryFailure(const char *data, size_t length)
+{
+    static const char prefix[] = "421 ";
+    return length >= sizeof(prefix) - 1 && std::memcmp(data, prefix, sizeof(prefix) - 1) == 0;
+}
+
+// Keep up to `depth` messages in flight and reassemble the echoed stream.
+// The socket is non-blocking and poll() waits on both directions, so echoes
+// keep draining while a deep window is still being written; blocking writes
+// would stall both ends once the window outgrows the socket buffers.
+static void runTCPClient(const BenchConfig &config, BenchResult &result)
+{
+    io_service ioService;
+    tcp::socket socket(ioService);
+    socket.connect(tcp::endpoint(ip::address_v4::loopback(), config.port));
+    socket.set_option(tcp::no_delay(true));
+    socket.non_blocking(true);
+
+    std::vector<char> message(config.size, 'x');
+    std::vector<char> inbound(config.size);
+    size_t messageOffset = 0; // Bytes of the message being sent already written
+    size_t inboundFill = 0;
+    size_t sent = 0;
+    size_t received = 0;
+    result.latencies.reserve(config.messages);
+
+    while (received < config.messages)
+    {
+        bool canSend = sent < config.messages && sent - received < config.depth;
+        pollfd ready{socket.native_handle(), static_cast<short>(POLLIN | (canSend ? POLLOUT : 0)), 0};
+        if (poll(&ready, 1, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw boost::system::system_error(errno, boost::system::system_category(), "poll");
+        }
+
+        while (sent < config.messages && sent - received < config.depth)
+        {
+            if (messageOffset == 0)
+            {
+                stampMessage(message.data());
+            }
+            boost::system::error_code error;
+            size_t length = socket.write_some(
+                boost::asio::buffer(message.data() + messageOffset, config.size - messageOffset), error);
+            if (error == boost::asio::error::would_block)
+            {
+                break;
+            }
+            if (error == boost::asio::error::broken_pipe || error == boost::asio::error::connection_reset)
+            {
+                result.rejected = true;
+                return;
+            }
+            if (error)
+            {
+                throw boost::system::system_error(error, "write_some");
+            }
+            messageOffset += length;
+            if (messageOffset == config.size)
+            {
+                messageOffset = 0;
+                ++sent;
+            }
+        }
+
+        while (received < config.messages)
+        {
+            char chunk[MAX_BUFFER_SIZE * 16];
+            boost::system::error_code error;
+            size_t length = socket.read_some(boost::asio::buffer(chunk), error);
+            if (error == boost::asio::error::would_block)
+            {
+                break;
+            }
+            if (error == boost::asio::error::eof || error == boost::asio::error::connection_reset ||
+                (received == 0 && inboundFill == 0 && isTemporaryFailure(chunk, length)))
+            {
+                result.rejected = true;
+                return;
+            }
+            if (error)
+            {
+                throw boost::system::system_error(error, "read_some");
+            }
+            size_t pos = 0;
+            while (pos < length)
+            {
+                size_t take = std::min(length - pos, config.size - inboundFill);
+                std::memcpy(inbound.data() + inboundFill, chunk + pos, take);
+                inboundFill += take;
+                pos += take;
+                if (inboundFill == config.size)
+                {
+                    result.latencies.push_back(elapsedSince(inbound.data()));
+                    result.bytes += config.size;
+                    inboundFill = 0;
+                    ++received;
+                }
+            }
+        }
+    }
+}
+
+// Datagrams may be dropped under load, so a receive timeout resets the window
+static void runUDPClient(const BenchConfig &config, BenchResult &result)
+{
+    io_service ioService;
+    udp::socket socket(ioService, udp::endpoint(udp::v4(), 0));
+    udp::endpoint server(ip::address_v4::loopback(), config.port);
+
+    timeval timeout{0, 100000};
+    setsockopt(socket.native_handle(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::vector<char> message(config.size, 'x');
+    std::vector<char> inbound(MAX_BUFFER_SIZE);
+    size_t sent = 0;
+    size_t inFlight = 0;
+    result.latencies.reserve(config.messages);
+
+    while (sent < config.messages || inFlight > 0)
+    {
+        while (sent < config.messages && inFlight < config.depth)
+        {
+            stampMessage(message.data());
+            socket.send_to(boost::asio::buffer(message), server);
+            ++sent;
+            ++inFlight;
+        }
+
+        // Plain recv() so SO_RCVTIMEO applies; asio would poll() indefinitely
+        ssize_t length = recv(socket.native_handle(), inbound.data(), inbound.size(), 0);
+        if (length < 0)
+        {
+            result.lost += inFlight;
+            inFlight = 0;
+            continue;
+        }
+        if (static_cast<size_t>(length) >= MIN_MESSAGE_SIZE)
+        {
+            result.latencies.push_back(elapsedSince(inbound.data()));
+            result.bytes += length;
+        }
+        --inFlight;
+    }
+}
+
+// Default limits, widened so every benchmark connection plus the startup
+// probe fits in the per-address burst and the connection cap
+static MailServerLimits benchLimits(const BenchConfig &config)
+{
+    MailServerLimits limits;
+    size_t needed = config.connections + 1;
+    limits.maxConnections = std::max(limits.maxConnections, needed);
+    limits.connectionBurstPerIP = std::max(limits.connectionBurstPerIP, static_cast<double>(needed));
+    limits.connectionsPerSecondPerIP = std::max(limits.connectionsPerSecondPerIP, static_cast<double>(needed));
+    return limits;
+}
+
+template <typename ProtocolType>
+static pid_t spawnServer(const BenchConfig &config)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        try
+        {
+            io_service ioService;
+            if constexpr (std::is_same_v<ProtocolType, tcp>)
+            {
+                MailServer<tcp> server(ioService, config.port, false, benchLimits(config));
+                ioService.run();
+            }
+            else
+            {
+                MailServer<udp> server(ioService, config.port, false);
+                ioService.run();
+            }
+        }
+        catch (std::exception &e)
+        {
+            std::cerr << "Exception in server: " << e.what() << std::endl;
+        }
+        _exit(0);
+    }
+    return pid;
+}
+
+static void waitForTCPServer(unsigned short port)
+{
+    io_service ioService;
+    for (int attempt = 0; attempt < 100; ++attempt)
+    {
+        tcp::socket probe(ioService);
+        boost::system::error_code error;
+        probe.connect(tcp::endpoint(ip::address_v4::loopback(), port), error);
+        if (!error)
+        {
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    throw std::runtime_error("server did not start on port " + std::to_string(port));
+}
+
+static uint64_t percentile(const std::vector<uint64_t> &sorted, double p)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    size_t rank = static_cast<size_t>(p / 100.0 * (sorted.size() - 1));
+    return sorted[rank];
+}
+
+static double seconds(const timeval &tv)
+{
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static bool parseArgs(int argc, char **argv, BenchConfig &config)
+{
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        std::string value = argv[i + 1];
+        if (flag == "--proto")
+            config.proto = value;
+        else if (flag == "--connections")
+            config.connections = std::stoul(value);
+        else if (flag == "--size")
+            config.size = std::stoul(value);
+        else if (flag == "--depth")
+            config.depth = std::stoul(value);
+        else if (flag == "--messages")
+            config.messages = std::stoul(value);
+        else if (flag == "--port")
+            config.port = static_cast<unsigned short>(std::stoul(value));
+        else
+            return false;
+    }
+    if (config.proto != "tcp" && config.proto != "udp")
+    {
+        return false;
+    }
+    if (config.size < MIN_MESSAGE_SIZE || (config.proto == "udp" && config.size > MAX_BUFFER_SIZE))
+    {
+        std::cerr << "Message size must be between " << MIN_MESSAGE_SIZE << " and "
+                  << MAX_BUFFER_SIZE << " bytes for UDP" << std::endl;
+        return false;
+    }
+    config.connections = std::max<size_t>(config.connections, 1);
+    config.depth = std::max<size_t>(config.depth, 1);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    BenchConfig config;
+    if (!parseArgs(argc, argv, config))
+    {
+        std::cerr << "Usage: " << argv[0] << " [--proto tcp|udp] [--connections N] [--size BYTES]"
+                  << " [--depth N] [--messages N] [--port PORT]" << std::endl;
+        return 1;
+    }
+
+    bool isTCP = config.proto == "tcp";
+    pid_t server = isTCP ? spawnServer<tcp>(config) : spawnServer<udp>(config);
+    if (server < 0)
+    {
+        std::cerr << "Error: fork failed" << std::endl;
+        return 1;
+    }
+
+    std::vector<BenchResult> results(config.connections);
+    std::atomic<bool> failed{false};
+    Clock::time_point start, end;
+    try
+    {
+        if (isTCP)
+        {
+            waitForTCPServer(config.port);
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+
+        std::vector<std::thread> clients;
+        start = Clock::now();
+        for (size_t i = 0; i < config.connections; ++i)
+        {
+            clients.emplace_back([&, i]() {
+                try
+                {
+                    isTCP ? runTCPClient(config, results[i]) : runUDPClient(config, results[i]);
+                }
+                catch (std::exception &e)
+                {
+                    std::cerr << "Exception in client: " << e.what() << std::endl;
+                    failed = true;
+                }
+            });
+        }
+        for (auto &client : clients)
+        {
+            client.join();
+        }
+        end = Clock::now();
+    }
+    catch (std::exception &e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        failed = true;
+    }
+
+    kill(server, SIGTERM);
+    int status = 0;
+    rusage usage{};
+    wait4(server, &status, 0, &usage);
+    if (failed)
+    {
+        return 1;
+    }
+
+    std::vector<uint64_t> latencies;
+    uint64_t bytes = 0;
+    uint64_t lost = 0;
+    size_t rejected = 0;
+    for (auto &result : results)
+    {
+        rejected += result.rejected;
+        latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+        bytes += result.bytes;
+        lost += result.lost;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    double elapsed = std::chrono::duration<double>(end - start).count();
+    double messages = static_cast<double>(latencies.size());
+    double serverCPU = seconds(usage.ru_utime) + seconds(usage.ru_stime);
+
+    std::cout << "proto=" << config.proto << " connections=" << config.connections
+              << " size=" << config.size << " depth=" << config.depth
+              << " messages=" << config.messages * config.connections << "\n";
+    std::cout << "elapsed: " << elapsed << " s";
+    if (!isTCP)
+    {
+        std::cout << ", lost: " << lost;
+    }
+    if (rejected > 0)
+    {
+        std::cout << ", rejected by server (421): " << rejected;
+    }
+    std::cout << "\n";
+    std::cout << "throughput: " << messages / elapsed << " msg/s, "
+              << bytes / elapsed / (1024 * 1024) << " MiB/s\n";
+    std::cout << "latency (us): p50 " << percentile(latencies, 50) / 1e3
+              << ", p90 " << percentile(latencies, 90) / 1e3
+              << ", p99 " << percentile(latencies, 99) / 1e3
+              << ", p99.9 " << percentile(latencies, 99.9) / 1e3
+              << ", max " << (latencies.empty() ? 0 : latencies.back()) / 1e3 << "\n";
+    std::cout << "server cpu: user " << seconds(usage.ru_utime) << " s, sys " << seconds(usage.ru_stime)
+              << " s, " << (messages > 0 ? serverCPU / messages * 1e6 : 0) << " us/msg" << std::endl;
+    return 0;
+}
@@ -0,0 +1,630 @@
+#pragma once
+
+#include <iostream>
+#include <stdexcept>
+#include <initializer_list>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Custom Vector class. Storage is allocated uninitialized and elements are
+// constructed in place, so growing never default-constructs unused slots.
+template <typename T>
+class Vector {
+private:
+    T* data;             // Storage for `capacity` elements, the first `currentSize` constructed
+    size_t capacity;     // Capacity of the vector
+    size_t currentSize;  // Current number of elements
+
+    static T* allocate(size_t count) {
+        return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(alignof(T))));
+    }
+
+    static void deallocate(T* ptr) {
+        ::operator delete(ptr, std::align_val_t(alignof(T)));
+    }
+
+    // Moves `count` elements from `from` into uninitialized `to` and destroys
+    // the originals. Trivially copyable types are moved with one memcpy.
+    static void relocate(T* from, size_t count, T* to) {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            if (count) {
+                std::memcpy(static_cast<void*>(to), static_cast<const void*>(from), count * sizeof(T));
+            }
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                ::new (static_cast<void*>(to + i)) T(std::move_if_noexcept(from[i]));
+                from[i].~T();
+            }
+        }
+    }
+
+    void destroyFrom(size_t first) {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            for (size_t i = first; i < currentSize; ++i) {
+                data[i].~T();
+            }
+        }
+        currentSize = first;
+    }
+
+    // Function to move the elements into storage for `newCapacity` elements
+    void reallocate(size_t newCapacity) {
+        T* newData = allocate(newCapacity);
+        relocate(data, currentSize, newData);
+        deallocate(data);
+        data = newData;
+        capacity = newCapacity;
+    }
+
+    size_t grownCapacity(size_t required) const {
+        return std::max(required, capacity ? capacity * 2 : 4);
+    }
+
+public:
+    // Constructor, allocates nothing until the first element
+    Vector() : data(nullptr), capacity(0), currentSize(0) {}
+
+    Vector(const Vector& other) : data(nullptr), capacity(0), currentSize(0) {
+        reserve(other.currentSize);
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            if (other.currentSize) {
+                std::memcpy(static_cast<void*>(data), static_cast<const void*>(other.data), other.currentSize * sizeof(T));
+            }
+            currentSize = other.currentSize;
+        } else {
+            for (size_t i = 0; i < other.currentSize; ++i) {
+                push_back(other.data[i]);
+            }
+        }
+    }
+
+    Vector(Vector&& other) noexcept : data(other.data), capacity(other.capacity), currentSize(other.currentSize) {
+        other.data = nullptr;
+        other.capacity = 0;
+        other.currentSize = 0;
+    }
+
+    Vector& operator=(const Vector& other) {
+        if (this != &other) {
+            Vector copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    Vector& operator=(Vector&& other) noexcept {
+        if (this != &other) {
+            destroyFrom(0);
+            deallocate(data);
+            data = std::exchange(other.data, nullptr);
+            capacity = std::exchange(other.capacity, 0);
+            currentSize = std::exchange(other.currentSize, 0);
+        }
+        return *this;
+    }
+
+    ~Vector() {
+        destroyFrom(0);
+        deallocate(data);
+    }
+
+    // Make room for at least `count` elements without constructing any
+    void reserve(size_t count) {
+        if (count > capacity) {
+            reallocate(count);
+        }
+    }
+
+    // Construct an element in place at the end
+    template <typename... Args>
+    T& emplace_back(Args&&... args) {
+        if (currentSize == capacity) {
+            // Build the new element first: `args` may refer to an element
+            // of this vector, which relocation would move away
+            size_t newCapacity = grownCapacity(currentSize + 1);
+            T* newData = allocate(newCapacity);
+            try {
+                ::new (static_cast<void*>(newData + currentSize)) T(std::forward<Args>(args)...);
+            } catch (...) {
+                deallocate(newData);
+                throw;
+            }
+            relocate(data, currentSize, newData);
+            deallocate(data);
+            data = newData;
+            capacity = newCapacity;
+        } else {
+            ::new (static_cast<void*>(data + currentSize)) T(std::forward<Args>(args)...);
+        }
+        return data[currentSize++];
+    }
+
+    // Add an element to the vector
+    void push_back(const T& value) {
+        emplace_back(value);
+    }
+
+    void push_back(T&& value) {
+        emplace_back(std::move(value));
+    }
+
+    // Grow to `count` copies of `value` after the current elements, or shrink
+    // to `count`, with at most one allocation
+    void resize(size_t count, const T& value) {
+        if (count <= currentSize) {
+            destroyFrom(count);
+            return;
+        }
+        if (count > capacity) {
+            T copy(value);  // `value` may live in the storage being replaced
+            reallocate(count);
+            std::uninitialized_fill_n(data + currentSize, count - currentSize, copy);
+        } else {
+            std::uninitialized_fill_n(data + currentSize, count - currentSize, value);
+        }
+        currentSize = count;
+    }
+
+    void resize(size_t count) {
+        resize(count, T());
+    }
+
+    void clear() {
+        destroyFrom(0);
+    }
+
+    // Get the number of elements in the vector
+    size_t size() const {
+        return currentSize;
+    }
+
+    // Get the number of elements that fit without reallocating
+    size_t getCapacity() const {
+        return capacity;
+    }
+
+    // Access element by index
+    T& operator[](size_t index) {
+        if (index >= currentSize) {
+            throw std::out_of_range("Index out of range.");
+        }
+        return data[index];
+    }
+
+    // Access element by index (const version)
+    const T& operator[](size_t index) const {
+        if (index >= currentSize) {
+            throw std::out_of_range("Index out of range.");
+        }
+        return data[index];
+    }
+
+    T* begin() { return data; }
+    T* end() { return data + currentSize; }
+    const T* begin() const { return data; }
+    const T* end() const { return data + currentSize; }
+};
+
+// Largest rank supported by NDArrayView, whose metadata is stored inline
+#define NDA_MAX_RANK 8
+
+// Rank of an NDArray whose number of dimensions is chosen at runtime.
+// NDArray<T, N> for a fixed N is defined in nda_fixed.hpp.
+#define NDA_DYNAMIC_RANK SIZE_MAX
+
+template <typename T, size_t Rank = NDA_DYNAMIC_RANK>
+class NDArray;
+
+// Strided view over the elements of an NDArray (or any buffer). A view is
+// a base pointer plus a shape and per-axis strides in elements, so slicing,
+// indexing an axis, transposing and reshaping only rewrite that metadata and
+// never touch the elements. Views do not own their storage: they stay valid
+// while the array they were taken from is alive and not resized.
+template <typename T>
+class NDArrayView {
+private:
+    T* basePtr;                       // Element at index (0, ..., 0)
+    size_t rankCount;                 // Number of axes
+    size_t shape[NDA_MAX_RANK];       // Extent of each axis
+    ptrdiff_t strides[NDA_MAX_RANK];  // Distance in elements between neighbours along each axis
+
+    void checkAxis(size_t axis) const {
+        if (axis >= rankCount) {
+            throw std::out_of_range("Axis out of range.");
+        }
+    }
+
+public:
+    NDArrayView() : basePtr(nullptr), rankCount(0) {}
+
+    // View of `rank` axes with the given extents and strides
+    NDArrayView(T* base, size_t rank, const size_t* dims, const ptrdiff_t* steps) : basePtr(base), rankCount(rank) {
+        if (rank > NDA_MAX_RANK) {
+            throw std::invalid_argument("Rank exceeds NDA_MAX_RANK.");
+        }
+        for (size_t i = 0; i < rank; ++i) {
+            shape[i] = dims[i];
+            strides[i] = steps[i];
+        }
+    }
+
+    // Row-major contiguous view of `rank` axes
+    NDArrayView(T* base, size_t rank, const size_t* dims) : basePtr(base), rankCount(rank) {
+        if (rank > NDA_MAX_RANK) {
+            throw std::invalid_argument("Rank exceeds NDA_MAX_RANK.");
+        }
+        ptrdiff_t step = 1;
+        for (size_t i = rank; i-- > 0;) {
+            shape[i] = dims[i];
+            strides[i] = step;
+            step *= static_cast<ptrdiff_t>(dims[i]);
+        }
+    }
+
+    // Views of T convert to views of const T
+    template <typename U = T, typename = std::enable_if_t<!std::is_const_v<U>>>
+    operator NDArrayView<const U>() const {
+        return NDArrayView<const T>(basePtr, rankCount, shape, strides);
+    }
+
+    size_t rank() const { return rankCount; }
+    size_t dim(size_t axis) const { checkAxis(axis); return shape[axis]; }
+    ptrdiff_t stride(size_t axis) const { checkAxis(axis); return strides[axis]; }
+    T* base() const { return basePtr; }
+
+    // Function to get the number of elements in the view
+    size_t size() const {
+        size_t total = 1;
+        for (size_t i = 0; i < rankCount; ++i) {
+            total *= shape[i];
+        }
+        return total;
+    }
+
+    // True if the elements are laid out row-major without gaps
+    bool isContiguous() const {
+        ptrdiff_t step = 1;
+        for (size_t i = rankCount; i-- > 0;) {
+            if (shape[i] != 1 && strides[i] != step) {
+                return false;
+            }
+            step *= static_cast<ptrdiff_t>(shape[i]);
+        }
+        return true;
+    }
+
+    // Element at `indices`, with bounds checks
+    T& at(const Vector<size_t>& indices) const {
+        if (indices.size() != rankCount) {
+            throw std::out_of_range("Incorrect number of indices.");
+        }
+        ptrdiff_t offset = 0;
+        for (size_t i = 0; i < rankCount; ++i) {
+            if (indices[i] >= shape[i]) {
+                throw std::out_of_range("Index out of range.");
+            }
+            offset += static_cast<ptrdiff_t>(indices[i]) * strides[i];
+        }
+        return basePtr[offset];
+    }
+
+    // Function to set a value at specific indices
+    void setValue(const Vector<size_t>& indices, const T& value) const {
+        at(indices) = value;
+    }
+
+    // Function to get a value at specific indices
+    std::remove_const_t<T> getValue(const Vector<size_t>& indices) const {
+        return at(indices);
+    }
+
+    // Elements [start, stop) of `axis`, every `step`-th one
+    NDArrayView slice(size_t axis, size_t start, size_t stop, size_t step = 1) const {
+        checkAxis(axis);
+        if (step == 0) {
+            throw std::invalid_argument("Slice step must be positive.");
+        }
+        stop = std::min(stop, shape[axis]);
+        start = std::min(start, stop);
+        NDArrayView result = *this;
+        result.basePtr = basePtr + static_cast<ptrdiff_t>(start) * strides[axis];
+        result.shape[axis] = (stop - start + step - 1) / step;
+        result.strides[axis] = strides[axis] * static_cast<ptrdiff_t>(step);
+        return result;
+    }
+
+    // The sub-array at position `index` of `axis`, with that axis removed;
+    // e.g. index(0, i) is row i of a matrix
+    NDArrayView index(size_t axis, size_t position) const {
+        checkAxis(axis);
+        if (position >= shape[axis]) {
+            throw std::out_of_range("Index out of range.");
+        }
+        NDArrayView result;
+        result.basePtr = basePtr + static_cast<ptrdiff_t>(position) * strides[axis];
+        for (size_t i = 0; i < rankCount; ++i) {
+            if (i != axis) {
+                result.shape[result.rankCount] = shape[i];
+                result.strides[result.rankCount] = strides[i];
+                ++result.rankCount;
+            }
+        }
+        return result;
+    }
+
+    // Axes in reverse order
+    NDArrayView transpose() const {
+        NDArrayView result = *this;
+        for (size_t i = 0; i < rankCount; ++i) {
+            result.shape[i] = shape[rankCount - 1 - i];
+            result.strides[i] = strides[rankCount - 1 - i];
+        }
+        return result;
+    }
+
+    // Axes reordered so that axis i of the result is axis axes[i] of this view
+    NDArrayView permute(const Vector<size_t>& axes) const {
+        if (axes.size() != rankCount) {
+            throw std::invalid_argument("Permutation must list every axis once.");
+        }
+        bool seen[NDA_MAX_RANK] = {};
+        NDArrayView result = *this;
+        for (size_t i = 0; i < rankCount; ++i) {
+            checkAxis(axes[i]);
+            if (seen[axes[i]]) {
+                throw std::invalid_argument("Permutation must list every axis once.");
+            }
+            seen[axes[i]] = true;
+            result.shape[i] = shape[axes[i]];
+            result.strides[i] = strides[axes[i]];
+        }
+        return result;
+    }
+
+    // Same elements under a new shape. Only contiguous views can be reshaped
+    // without copying; use NDArray(view) to make a contiguous copy first.
+    NDArrayView reshape(const Vector<size_t>& dims) const {
+        if (!isContiguous()) {
+            throw std::logic_error("Only contiguous views can be reshaped.");
+        }
+        size_t total = 1;
+        for (size_t i = 0; i < dims.size(); ++i) {
+            total *= dims[i];
+        }
+        if (total != size()) {
+            throw std::invalid_argument("Reshape must keep the number of elements.");
+        }
+        return NDArrayView(basePtr, dims.size(), dims.begin());
+    }
+
+    // Calls f(element) for every element in row-major order. Contiguous views
+    // are one flat loop; strided views run the innermost axis as a strided
+    // loop and step the outer axes like an odometer.
+    template <typename F>
+    void forEach(F&& f) const {
+        if (rankCount == 0) {
+            f(*basePtr);
+            return;
+        }
+        size_t total = size();
+        if (total == 0) {
+            return;
+        }
+        if (isContiguous()) {
+            for (size_t i = 0; i < total; ++i) {
+                f(basePtr[i]);
+            }
+            return;
+        }
+
+        size_t inner = rankCount - 1;
+        size_t count = shape[inner];
+        ptrdiff_t step = strides[inner];
+        size_t counters[NDA_MAX_RANK] = {};
+        T* row = basePtr;
+        while (true) {
+            T* p = row;
+            for (size_t i = 0; i < count; ++i, p += step) {
+                f(*p);
+            }
+            // Advance the outer axes
+            size_t axis = inner;
+            while (axis-- > 0) {
+                row += strides[axis];
+                if (++counters[axis] < shape[axis]) {
+                    break;
+                }
+                row -= strides[axis] * static_cast<ptrdiff_t>(shape[axis]);
+                counters[axis] = 0;
+            }
+            if (axis == static_cast<size_t>(-1)) {
+                return;
+            }
+        }
+    }
+
+    // Function to print the data (for debugging purposes)
+    void print() const {
+        forEach([](const T& value) { std::cout << value << " "; });
+        std::cout << std::endl;
+    }
+};
+
+// Base of lazily evaluated elementwise expressions over NDArrays, built by
+// the operators in nda_expr.hpp. E provides shape(), size() and operator[].
+template <typename E>
+struct NDArrayExpression {
+    const E& self() const {
+        return static_cast<const E&>(*this);
+    }
+};
+
+// NDArray Class, with the rank chosen at runtime
+template <typename T>
+class NDArray<T, NDA_DYNAMIC_RANK> {
+private:
+    Vector<size_t> dimensions;  // Dimensions of the n-dimensional array
+    Vector<T> data;             // Flattened data storage
+
+    // Helper function to calculate index in the flattened array
+    size_t calculateIndex(const Vector<size_t>& indices) const {
+        if (indices.size() != dimensions.size()) {
+            throw std::out_of_range("Incorrect number of indices.");
+        }
+
+        size_t index = 0;
+        size_t offset = 1;
+        for (int i = dimensions.size() - 1; i >= 0; --i) {
+            if (indices[i] >= dimensions[i]) {
+                throw std::out_of_range("Index out of range.");
+            }
+            index += indices[i] * offset;
+            offset *= dimensions[i];
+        }
+        return index;
+    }
+
+public:
+    // Default constructor
+    NDArray() = default;
+
+    // Constructor to initialize the array with given dimensions
+    NDArray(const std::initializer_list<size_t>& dims) {
+        dimensions.reserve(dims.size());
+        for (auto dim : dims) {
+            dimensions.push_back(dim);
+        }
+
+        size_t totalSize = 1;
+        for (size_t i = 0; i < dimensions.size(); ++i) {
+            totalSize *= dimensions[i];
+        }
+        data.resize(totalSize, T());  // Initialize all elements to default value of T, in one allocation
+    }
+
+    // Constructor from dimensions built at runtime
+    explicit NDArray(const Vector<size_t>& dims) : dimensions(dims) {
+        size_t totalSize = 1;
+        for (size_t i = 0; i < dimensions.size(); ++i) {
+            totalSize *= dimensions[i];
+        }
+        data.resize(totalSize, T());
+    }
+
+    // Evaluates an expression such as a * b + c in one pass, with no
+    // temporary arrays for the intermediate results
+    template <typename E>
+    NDArray(const NDArrayExpression<E>& expression) {
+        *this = expression;
+    }
+
+    // Assigns an expression elementwise, taking its shape. Operands may
+    // include this array, since element i only reads element i of each.
+    template <typename E>
+    NDArray& operator=(const NDArrayExpression<E>& expression) {
+        const E& expr = expression.self();
+        const Vector<size_t>& shape = expr.shape();
+        bool same = shape.size() == dimensions.size();
+        for (size_t i = 0; same && i < shape.size(); ++i) {
+            same = shape[i] == dimensions[i];
+        }
+        if (!same) {
+            Vector<size_t> dims(shape);  // `shape` may belong to this array
+            dimensions = std::move(dims);
+            data.clear();
+            data.resize(expr.size(), T());
+        }
+        T* out = data.begin();
+        size_t n = data.size();
+        // Operands are whole arrays, either distinct from this one or this
+        // one exactly, so no iteration depends on another
+#pragma GCC ivdep
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = static_cast<T>(expr[i]);
+        }
+        return *this;
+    }
+
+    // Contiguous copy of the elements of a view, e.g. to materialize a slice
+    template <typename U>
+    explicit NDArray(const NDArrayView<U>& source) {
+        dimensions.reserve(source.rank());
+        for (size_t i = 0; i < source.rank(); ++i) {
+            dimensions.push_back(source.dim(i));
+        }
+        data.reserve(source.size());
+        source.forEach([this](const U& value) { data.push_back(value); });
+    }
+
+    // Row-major views over the whole array, for slicing and transposing
+    NDArrayView<T> view() {
+        return NDArrayView<T>(data.begin(), dimensions.size(), dimensions.begin());
+    }
+
+    NDArrayView<const T> view() const {
+        return NDArrayView<const T>(data.begin(), dimensions.size(), dimensions.begin());
+    }
+
+    size_t rank() const {
+        return dimensions.size();
+    }
+
+    const Vector<size_t>& shape() const {
+        return dimensions;
+    }
+
+    size_t dim(size_t axis) const {
+        return dimensions[axis];
+    }
+
+    // True if both arrays have the same dimensions
+    bool sameShape(const NDArray& other) const {
+        if (dimensions.size() != other.dimensions.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < dimensions.size(); ++i) {
+            if (dimensions[i] != other.dimensions[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Flattened row-major elements, for kernels that run over all of them
+    T* rawData() {
+        return data.begin();
+    }
+
+    const T* rawData() const {
+        return data.begin();
+    }
+
+    // Function to set a value at specific indices
+    void setValue(const Vector<size_t>& indices, const T& value) {
+        data[calculateIndex(indices)] = value;
+    }
+
+    // Function to get a value at specific indices
+    T getValue(const Vector<size_t>& indices) const {
+        return data[calculateIndex(indices)];
+    }
+
+    // Function to get the size of the n-dimensional array
+    size_t size() const {
+        return data.size();
+    }
+
+    // Function to print the data (for debugging purposes)
+    void print() const {
+        for (size_t i = 0; i < data.size(); ++i) {
+            std::cout << data[i] << " ";
+        }
+        std::cout << std::endl;
+    }
+};
@@ -0,0 +1,223 @@
+#pragma once
+
+#include "nda.hpp"
+
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// Lazy elementwise arithmetic on NDArrays.
+//
+// Operators on arrays, expressions and scalars return small expression
+// nodes instead of arrays: `a * b + c * 2` is a tree that holds pointers to
+// a, b and c and the scalar 2. Nothing is computed until the tree is
+// assigned to an NDArray or passed to eval(), which then runs one loop
+// computing each element of the result straight from the operands, with no
+// temporary arrays and one pass over memory.
+//
+// Nodes hold array operands by pointer and everything else by value, so an
+// expression must not outlive the arrays it reads; assign or eval() it in
+// the statement that builds it.
+
+// Leaf reading an NDArray
+template <typename T>
+class ArrayExpression : public NDArrayExpression<ArrayExpression<T>> {
+private:
+    const T* values;
+    const Vector<size_t>* dims;
+    size_t count;
+
+public:
+    using value_type = T;
+
+    explicit ArrayExpression(const NDArray<T>& array) : values(array.rawData()), dims(&array.shape()), count(array.size()) {}
+
+    const Vector<size_t>& shape() const { return *dims; }
+    size_t size() const { return count; }
+    T operator[](size_t i) const { return values[i]; }
+};
+
+// Leaf repeating one value for every element
+template <typename T>
+struct ScalarExpression {
+    using value_type = T;
+    T value;
+
+    T operator[](size_t) const { return value; }
+};
+
+namespace expr_detail {
+
+template <typename T>
+struct IsScalar : std::false_type {};
+template <typename T>
+struct IsScalar<ScalarExpression<T>> : std::true_type {};
+
+template <typename T>
+struct IsArray : std::false_type {};
+template <typename T>
+struct IsArray<NDArray<T>> : std::true_type {};
+
+template <typename T>
+constexpr bool isExpression = std::is_base_of_v<NDArrayExpression<T>, T>;
+
+// An array or expression, which gives a node its shape
+template <typename T>
+constexpr bool isShaped = IsArray<T>::value || isExpression<T>;
+
+template <typename T>
+constexpr bool isOperand = isShaped<T> || std::is_arithmetic_v<T>;
+
+// Operand as a node: arrays become ArrayExpression leaves, scalars
+// ScalarExpression leaves, and expressions stay as they are
+template <typename T>
+auto wrap(const NDArray<T>& array) {
+    return ArrayExpression<T>(array);
+}
+
+template <typename E, std::enable_if_t<isExpression<E>, int> = 0>
+const E& wrap(const E& expression) {
+    return expression;
+}
+
+template <typename T, std::enable_if_t<std::is_arithmetic_v<T>, int> = 0>
+ScalarExpression<T> wrap(T value) {
+    return ScalarExpression<T>{value};
+}
+
+template <typename T>
+using Wrapped = std::decay_t<decltype(wrap(std::declval<const T&>()))>;
+
+inline bool sameDims(const Vector<size_t>& a, const Vector<size_t>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i] != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct Add {
+    template <typename A, typename B>
+    static auto apply(A a, B b) { return a + b; }
+};
+
+struct Subtract {
+    template <typename A, typename B>
+    static auto apply(A a, B b) { return a - b; }
+};
+
+struct Multiply {
+    template <typename A, typename B>
+    static auto apply(A a, B b) { return a * b; }
+};
+
+struct Divide {
+    template <typename A, typename B>
+    static auto apply(A a, B b) { return a / b; }
+};
+
+}  // namespace expr_detail
+
+// Elementwise Op(left[i], right[i]); at least one side has a shape
+template <typename Op, typename L, typename R>
+class BinaryExpression : public NDArrayExpression<BinaryExpression<Op, L, R>> {
+private:
+    L left;
+    R right;
+
+public:
+    using value_type = decltype(Op::apply(std::declval<typename L::value_type>(), std::declval<typename R::value_type>()));
+
+    BinaryExpression(const L& l, const R& r) : left(l), right(r) {
+        if constexpr (!expr_detail::IsScalar<L>::value && !expr_detail::IsScalar<R>::value) {
+            if (!expr_detail::sameDims(left.shape(), right.shape())) {
+                throw std::invalid_argument("NDArray shapes do not match.");
+            }
+        }
+    }
+
+    const Vector<size_t>& shape() const {
+        if constexpr (expr_detail::IsScalar<L>::value) {
+            return right.shape();
+        } else {
+            return left.shape();
+        }
+    }
+
+    size_t size() const {
+        if constexpr (expr_detail::IsScalar<L>::value) {
+            return right.size();
+        } else {
+            return left.size();
+        }
+    }
+
+    value_type operator[](size_t i) const {
+        return Op::apply(left[i], right[i]);
+    }
+};
+
+// Elementwise -operand[i]
+template <typename E>
+class NegateExpression : public NDArrayExpression<NegateExpression<E>> {
+private:
+    E operand;
+
+public:
+    using value_type = decltype(-std::declval<typename E::value_type>());
+
+    explicit NegateExpression(const E& e) : operand(e) {}
+
+    const Vector<size_t>& shape() const { return operand.shape(); }
+    size_t size() const { return operand.size(); }
+    value_type operator[](size_t i) const { return -operand[i]; }
+};
+
+namespace expr_detail {
+
+template <typename Op, typename L, typename R>
+auto makeBinary(const L& l, const R& r) {
+    return BinaryExpression<Op, Wrapped<L>, Wrapped<R>>(wrap(l), wrap(r));
+}
+
+template <typename L, typename R>
+constexpr bool isOperandPair = isOperand<L> && isOperand<R> && (isShaped<L> || isShaped<R>);
+
+}  // namespace expr_detail
+
+template <typename L, typename R, std::enable_if_t<expr_detail::isOperandPair<L, R>, int> = 0>
+auto operator+(const L& l, const R& r) {
+    return expr_detail::makeBinary<expr_detail::Add>(l, r);
+}
+
+template <typename L, typename R, std::enable_if_t<expr_detail::isOperandPair<L, R>, int> = 0>
+auto operator-(const L& l, const R& r) {
+    return expr_detail::makeBinary<expr_detail::Subtract>(l, r);
+}
+
+template <typename L, typename R, std::enable_if_t<expr_detail::isOperandPair<L, R>, int> = 0>
+auto operator*(const L& l, const R& r) {
+    return expr_detail::makeBinary<expr_detail::Multiply>(l, r);
+}
+
+template <typename L, typename R, std::enable_if_t<expr_detail::isOperandPair<L, R>, int> = 0>
+auto operator/(const L& l, const R& r) {
+    return expr_detail::makeBinary<expr_detail::Divide>(l, r);
+}
+
+template <typename E, std::enable_if_t<expr_detail::isShaped<E>, int> = 0>
+auto operator-(const E& e) {
+    using Operand = expr_detail::Wrapped<E>;
+    return NegateExpression<Operand>(expr_detail::wrap(e));
+}
+
+// Materializes an expression into a new array
+template <typename E>
+NDArray<typename E::value_type> eval(const NDArrayExpression<E>& expression) {
+    return NDArray<typename E::value_type>(expression);
+}
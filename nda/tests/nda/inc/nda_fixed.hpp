@@ -0,0 +1,231 @@
+#pragma once
+
+#include "nda.hpp"
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// NDArrays whose rank is a template parameter.
+//
+// NDArray<T, Rank> keeps its dimensions and row-major strides in fixed-size
+// arrays computed once at construction, so operator()(i, j, k) takes its
+// indices as plain integers and reduces to i * s0 + j * s1 + k with no
+// allocation, loop or rank check. StaticNDArray<T, Dims...> also fixes the
+// dimensions, making the strides compile-time constants and the storage an
+// inline array.
+//
+// operator() is unchecked unless NDA_CHECK_BOUNDS is defined; at() always
+// checks and throws std::out_of_range like the dynamic-rank NDArray.
+
+namespace fixed_detail {
+
+template <size_t Rank>
+constexpr std::array<size_t, Rank> rowMajorStrides(const std::array<size_t, Rank>& dims) {
+    std::array<size_t, Rank> strides{};
+    size_t step = 1;
+    for (size_t i = Rank; i-- > 0;) {
+        strides[i] = step;
+        step *= dims[i];
+    }
+    return strides;
+}
+
+template <size_t Rank, size_t... Axis, typename... I>
+constexpr size_t offsetOf(const std::array<size_t, Rank>& strides, std::index_sequence<Axis...>, I... indices) {
+    // The last stride of a row-major layout is always 1
+    return ((static_cast<size_t>(indices) * (Axis + 1 == Rank ? 1 : strides[Axis])) + ...);
+}
+
+// i * strides[0] + j * strides[1] + ...
+template <size_t Rank, typename... I>
+constexpr size_t offset(const std::array<size_t, Rank>& strides, I... indices) {
+    return offsetOf(strides, std::index_sequence_for<I...>(), indices...);
+}
+
+template <size_t Rank, size_t... Axis, typename... I>
+void checkIndicesOf(const std::array<size_t, Rank>& dims, std::index_sequence<Axis...>, I... indices) {
+    if (!((static_cast<size_t>(indices) < dims[Axis]) && ...)) {
+        throw std::out_of_range("Index out of range.");
+    }
+}
+
+template <size_t Rank, typename... I>
+void checkIndices(const std::array<size_t, Rank>& dims, I... indices) {
+    checkIndicesOf(dims, std::index_sequence_for<I...>(), indices...);
+}
+
+template <typename... I>
+constexpr bool allIntegral = (std::is_integral_v<I> && ...);
+
+}  // namespace fixed_detail
+
+// NDArray Class, with the rank fixed at compile time
+template <typename T, size_t Rank>
+class NDArray {
+    static_assert(Rank > 0 && Rank <= NDA_MAX_RANK, "Rank must be between 1 and NDA_MAX_RANK.");
+
+private:
+    std::array<size_t, Rank> dimensions;  // Dimensions of the n-dimensional array
+    std::array<size_t, Rank> strides;     // Row-major strides in elements
+    Vector<T> data;                       // Flattened data storage
+
+public:
+    // Constructor to initialize the array with given dimensions, e.g. NDArray<float, 3>(4, 5, 6)
+    template <typename... D, typename = std::enable_if_t<sizeof...(D) == Rank && fixed_detail::allIntegral<D...>>>
+    explicit NDArray(D... dims) : NDArray(std::array<size_t, Rank>{static_cast<size_t>(dims)...}) {}
+
+    explicit NDArray(const std::array<size_t, Rank>& dims) : dimensions(dims), strides(fixed_detail::rowMajorStrides(dims)) {
+        size_t totalSize = 1;
+        for (size_t dim : dims) {
+            totalSize *= dim;
+        }
+        data.resize(totalSize, T());
+    }
+
+    // Element access, unchecked unless NDA_CHECK_BOUNDS is defined
+    template <typename... I>
+    T& operator()(I... indices) {
+        static_assert(sizeof...(I) == Rank, "Wrong number of indices.");
+#ifdef NDA_CHECK_BOUNDS
+        fixed_detail::checkIndices(dimensions, indices...);
+#endif
+        return data.begin()[fixed_detail::offset(strides, indices...)];
+    }
+
+    template <typename... I>
+    const T& operator()(I... indices) const {
+        static_assert(sizeof...(I) == Rank, "Wrong number of indices.");
+#ifdef NDA_CHECK_BOUNDS
+        fixed_detail::checkIndices(dimensions, indices...);
+#endif
+        return data.begin()[fixed_detail::offset(strides, indices...)];
+    }
+
+    // Element access with bounds checks
+    template <typename... I>
+    T& at(I... indices) {
+        static_assert(sizeof...(I) == Rank, "Wrong number of indices.");
+        fixed_detail::checkIndices(dimensions, indices...);
+        return data.begin()[fixed_detail::offset(strides, indices...)];
+    }
+
+    template <typename... I>
+    const T& at(I... indices) const {
+        static_assert(sizeof...(I) == Rank, "Wrong number of indices.");
+        fixed_detail::checkIndices(dimensions, indices...);
+        return data.begin()[fixed_detail::offset(strides, indices...)];
+    }
+
+    static constexpr size_t rank() {
+        return Rank;
+    }
+
+    size_t dim(size_t axis) const {
+        return dimensions[axis];
+    }
+
+    size_t stride(size_t axis) const {
+        return strides[axis];
+    }
+
+    // Function to get the size of the n-dimensional array
+    size_t size() const {
+        return data.size();
+    }
+
+    T* rawData() {
+        return data.begin();
+    }
+
+    const T* rawData() const {
+        return data.begin();
+    }
+
+    NDArrayView<T> view() {
+        return NDArrayView<T>(data.begin(), Rank, dimensions.data());
+    }
+
+    NDArrayView<const T> view() const {
+        return NDArrayView<const T>(data.begin(), Rank, dimensions.data());
+    }
+
+    // Function to print the data (for debugging purposes)
+    void print() const {
+        view().print();
+    }
+};
+
+// Array with both rank and dimensions fixed at compile time, stored inline
+template <typename T, size_t... Dims>
+class StaticNDArray {
+    static_assert(sizeof...(Dims) > 0 && sizeof...(Dims) <= NDA_MAX_RANK, "Rank must be between 1 and NDA_MAX_RANK.");
+
+public:
+    static constexpr size_t Rank = sizeof...(Dims);
+    static constexpr std::array<size_t, Rank> dimensions = {Dims...};
+    static constexpr std::array<size_t, Rank> strides = fixed_detail::rowMajorStrides(dimensions);
+    static constexpr size_t totalSize = (Dims * ...);
+
+    template <typename... I>
+    T& operator()(I... indices) {
+        static_assert(sizeof...(I) == Rank, "Wrong number of indices.");
+#ifdef NDA_CHECK_BOUNDS
+        fixed_detail::checkIndices(dimensions, indices...);
+#endif
+        return values[fixed_detail::offset(strides, indices...)];
+    }
+
+    template <typename... I>
+    const T& operator()(I... indices) const {
+        static_assert(sizeof...(I) == Rank, "Wrong number of indices.");
+#ifdef NDA_CHECK_BOUNDS
+        fixed_detail::checkIndices(dimensions, indices...);
+#endif
+        return values[fixed_detail::offset(strides, indices...)];
+    }
+
+    template <typename... I>
+    T& at(I... indices) {
+        static_assert(sizeof...(I) == Rank, "Wrong number of indices.");
+        fixed_detail::checkIndices(dimensions, indices...);
+        return values[fixed_detail::offset(strides, indices...)];
+    }
+
+    template <typename... I>
+    const T& at(I... indices) const {
+        static_assert(sizeof...(I) == Rank, "Wrong number of indices.");
+        fixed_detail::checkIndices(dimensions, indices...);
+        return values[fixed_detail::offset(strides, indices...)];
+    }
+
+    static constexpr size_t size() {
+        return totalSize;
+    }
+
+    T* rawData() {
+        return values;
+    }
+
+    const T* rawData() const {
+        return values;
+    }
+
+    NDArrayView<T> view() {
+        return NDArrayView<T>(values, Rank, dimensions.data());
+    }
+
+    NDArrayView<const T> view() const {
+        return NDArrayView<const T>(values, Rank, dimensions.data());
+    }
+
+    // Function to print the data (for debugging purposes)
+    void print() const {
+        view().print();
+    }
+
+private:
+    T values[totalSize] = {};
+};
@@ -0,0 +1,356 @@
+#pragma once
+
+#include "nda.hpp"
+#include "nda_parallel.hpp"
+#include "nda_simd.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+
+// Cache-blocked transpose and matrix multiply on row-major storage.
+//
+// gemm follows the usual blocked layout: C is computed in NC-wide column
+// panels; for each KC-deep slice of the inner dimension, the matching slice
+// of B is packed once into NR-wide micro-panels (KC x NR, sized for L1),
+// and each MC-tall block of A is packed into MR-tall micro-panels (MC x KC,
+// sized for L2). A register-blocked micro-kernel then adds one MR x NR tile
+// of C from one micro-panel of each, reading both packed panels
+// sequentially. Blocks of A are independent, so they are spread over a
+// ThreadPool when one is given; for a batch of products, (product, block)
+// pairs are.
+//
+// For float the micro-kernel is 6 x 16 with AVX2/FMA when the CPU has it;
+// every other case uses a portable kernel the compiler can vectorize.
+
+namespace linalg {
+
+template <typename T>
+struct Blocking {
+    static constexpr size_t MR = 4, NR = 4, MC = 64, KC = 256, NC = 1024;
+};
+
+template <>
+struct Blocking<float> {
+    static constexpr size_t MR = 6, NR = 16, MC = 96, KC = 256, NC = 2048;
+};
+
+template <>
+struct Blocking<double> {
+    static constexpr size_t MR = 6, NR = 8, MC = 96, KC = 256, NC = 1024;
+};
+
+// Side of the square tiles transpose copies through, about 4 KiB each
+template <typename T>
+constexpr size_t transposeTile() {
+    return sizeof(T) <= 4 ? 32 : 16;
+}
+
+// C[MR x NR] (row stride ldc) += packed A micro-panel * packed B micro-panel
+template <typename T>
+void microKernel(size_t kc, const T* a, const T* b, T* c, size_t ldc) {
+    constexpr size_t MR = Blocking<T>::MR, NR = Blocking<T>::NR;
+    T acc[MR][NR] = {};
+    for (size_t p = 0; p < kc; ++p, a += MR, b += NR) {
+        for (size_t r = 0; r < MR; ++r) {
+            T ar = a[r];
+            for (size_t j = 0; j < NR; ++j) {
+                acc[r][j] += ar * b[j];
+            }
+        }
+    }
+    for (size_t r = 0; r < MR; ++r) {
+        for (size_t j = 0; j < NR; ++j) {
+            c[r * ldc + j] += acc[r][j];
+        }
+    }
+}
+
+#ifdef NDA_SIMD_X86
+
+// 6 x 16 float tile held in twelve AVX registers
+NDA_TARGET_AVX2 inline void microKernelAvx2(size_t kc, const float* a, const float* b, float* c, size_t ldc) {
+    __m256 c00 = _mm256_setzero_ps(), c01 = c00, c10 = c00, c11 = c00, c20 = c00, c21 = c00;
+    __m256 c30 = c00, c31 = c00, c40 = c00, c41 = c00, c50 = c00, c51 = c00;
+    for (size_t p = 0; p < kc; ++p, a += 6, b += 16) {
+        __m256 b0 = _mm256_loadu_ps(b);
+        __m256 b1 = _mm256_loadu_ps(b + 8);
+        __m256 ar = _mm256_broadcast_ss(a);
+        c00 = _mm256_fmadd_ps(ar, b0, c00);
+        c01 = _mm256_fmadd_ps(ar, b1, c01);
+        ar = _mm256_broadcast_ss(a + 1);
+        c10 = _mm256_fmadd_ps(ar, b0, c10);
+        c11 = _mm256_fmadd_ps(ar, b1, c11);
+        ar = _mm256_broadcast_ss(a + 2);
+        c20 = _mm256_fmadd_ps(ar, b0, c20);
+        c21 = _mm256_fmadd_ps(ar, b1, c21);
+        ar = _mm256_broadcast_ss(a + 3);
+        c30 = _mm256_fmadd_ps(ar, b0, c30);
+        c31 = _mm256_fmadd_ps(ar, b1, c31);
+        ar = _mm256_broadcast_ss(a + 4);
+        c40 = _mm256_fmadd_ps(ar, b0, c40);
+        c41 = _mm256_fmadd_ps(ar, b1, c41);
+        ar = _mm256_broadcast_ss(a + 5);
+        c50 = _mm256_fmadd_ps(ar, b0, c50);
+        c51 = _mm256_fmadd_ps(ar, b1, c51);
+    }
+    const __m256 rows[6][2] = {{c00, c01}, {c10, c11}, {c20, c21}, {c30, c31}, {c40, c41}, {c50, c51}};
+    for (size_t r = 0; r < 6; ++r) {
+        float* row = c + r * ldc;
+        _mm256_storeu_ps(row, _mm256_add_ps(_mm256_loadu_ps(row), rows[r][0]));
+        _mm256_storeu_ps(row + 8, _mm256_add_ps(_mm256_loadu_ps(row + 8), rows[r][1]));
+    }
+}
+
+#endif  // NDA_SIMD_X86
+
+template <typename T>
+using MicroKernel = void (*)(size_t, const T*, const T*, T*, size_t);
+
+template <typename T>
+MicroKernel<T> selectMicroKernel() {
+#ifdef NDA_SIMD_X86
+    if constexpr (std::is_same_v<T, float>) {
+        if (simd::activeLevel() >= simd::Level::AVX2) {
+            return microKernelAvx2;
+        }
+    }
+#endif
+    return microKernel<T>;
+}
+
+// Copies rows [0, mc) x columns [0, kc) of A into MR-row micro-panels,
+// column by column, zero-padding the last panel
+template <typename T>
+void packA(const T* a, size_t lda, size_t mc, size_t kc, T* out) {
+    constexpr size_t MR = Blocking<T>::MR;
+    for (size_t i = 0; i < mc; i += MR) {
+        size_t rows = std::min(MR, mc - i);
+        for (size_t p = 0; p < kc; ++p) {
+            for (size_t r = 0; r < MR; ++r) {
+                *out++ = r < rows ? a[(i + r) * lda + p] : T();
+            }
+        }
+    }
+}
+
+// Copies rows [0, kc) x columns [0, nc) of B into NR-column micro-panels,
+// row by row, zero-padding the last panel
+template <typename T>
+void packB(const T* b, size_t ldb, size_t kc, size_t nc, T* out) {
+    constexpr size_t NR = Blocking<T>::NR;
+    for (size_t j = 0; j < nc; j += NR) {
+        size_t cols = std::min(NR, nc - j);
+        for (size_t p = 0; p < kc; ++p) {
+            const T* row = b + p * ldb + j;
+            for (size_t c = 0; c < NR; ++c) {
+                *out++ = c < cols ? row[c] : T();
+            }
+        }
+    }
+}
+
+// Adds rows [ic, ic + mc) of A (kc columns from `a`) times one packed
+// kc x nc slice of B to the same rows of C (nc columns from `c`)
+template <typename T>
+void gemmBlock(MicroKernel<T> kernel, size_t ic, size_t mc, size_t nc, size_t kc, const T* a, size_t lda,
+               const T* packedB, T* c, size_t ldc, T* packedA) {
+    using B = Blocking<T>;
+    alignas(64) T edge[B::MR * B::NR];
+    packA(a + ic * lda, lda, mc, kc, packedA);
+    for (size_t jr = 0; jr < nc; jr += B::NR) {
+        const T* panelB = packedB + (jr / B::NR) * kc * B::NR;
+        for (size_t ir = 0; ir < mc; ir += B::MR) {
+            const T* panelA = packedA + (ir / B::MR) * kc * B::MR;
+            T* tile = c + (ic + ir) * ldc + jr;
+            size_t rows = std::min(B::MR, mc - ir);
+            size_t cols = std::min(B::NR, nc - jr);
+            if (rows == B::MR && cols == B::NR) {
+                kernel(kc, panelA, panelB, tile, ldc);
+                continue;
+            }
+            // Edge tile: compute in full, then add the part inside C
+            std::fill(edge, edge + B::MR * B::NR, T());
+            kernel(kc, panelA, panelB, edge, B::NR);
+            for (size_t r = 0; r < rows; ++r) {
+                for (size_t j = 0; j < cols; ++j) {
+                    tile[r * ldc + j] += edge[r * B::NR + j];
+                }
+            }
+        }
+    }
+}
+
+// C (m x n) = A (m x k) * B (k x n), all row-major with the given row
+// strides. Blocks of A are spread over `pool` if one is given.
+template <typename T>
+void gemm(size_t m, size_t n, size_t k, const T* a, size_t lda, const T* b, size_t ldb, T* c, size_t ldc,
+          ThreadPool* pool = nullptr) {
+    using B = Blocking<T>;
+    for (size_t i = 0; i < m; ++i) {
+        std::fill(c + i * ldc, c + i * ldc + n, T());
+    }
+    if (m == 0 || n == 0 || k == 0) {
+        return;
+    }
+
+    MicroKernel<T> kernel = selectMicroKernel<T>();
+    Vector<T> packedB;
+    packedB.resize(B::KC * ((std::min(n, B::NC) + B::NR - 1) / B::NR * B::NR), T());
+    size_t blocks = (m + B::MC - 1) / B::MC;
+
+    for (size_t jc = 0; jc < n; jc += B::NC) {
+        size_t nc = std::min(B::NC, n - jc);
+        for (size_t pc = 0; pc < k; pc += B::KC) {
+            size_t kc = std::min(B::KC, k - pc);
+            packB(b + pc * ldb + jc, ldb, kc, nc, packedB.begin());
+
+            auto body = [&](size_t first, size_t last) {
+                // One packed block of A per thread, reused across calls
+                thread_local Vector<T> packedA;
+                if (packedA.size() < B::MC * B::KC) {
+                    packedA.resize(B::MC * B::KC, T());
+                }
+                for (size_t block = first; block < last; ++block) {
+                    size_t ic = block * B::MC;
+                    gemmBlock(kernel, ic, std::min(B::MC, m - ic), nc, kc, a + pc, lda, packedB.begin(), c + jc, ldc,
+                              packedA.begin());
+                }
+            };
+            if (pool) {
+                pool->parallelFor(blocks, 1, body);
+            } else {
+                body(0, blocks);
+            }
+        }
+    }
+}
+
+// C[p] = A[p] * B[p] for `batches` products laid out `strideA`, `strideB`
+// and `strideC` elements apart (strideB 0 shares one B). With a pool, the
+// work is split into (product, block of A) pairs, so a batch of small
+// matrices, each a single block, still uses every thread. Each pair packs
+// its own slices of B, which costs about 1/MC of its multiply.
+template <typename T>
+void gemmBatched(size_t batches, size_t m, size_t n, size_t k, const T* a, size_t strideA, const T* b, size_t strideB,
+                 T* c, size_t strideC, ThreadPool* pool = nullptr) {
+    using B = Blocking<T>;
+    if (!pool || batches <= 1 || m == 0 || n == 0 || k == 0) {
+        for (size_t p = 0; p < batches; ++p) {
+            gemm(m, n, k, a + p * strideA, k, b + p * strideB, n, c + p * strideC, n, pool);
+        }
+        return;
+    }
+
+    MicroKernel<T> kernel = selectMicroKernel<T>();
+    size_t blocks = (m + B::MC - 1) / B::MC;
+    auto body = [&](size_t first, size_t last) {
+        // Packing buffers per thread, reused across calls
+        thread_local Vector<T> packedA, packedB;
+        if (packedA.size() < B::MC * B::KC) {
+            packedA.resize(B::MC * B::KC, T());
+        }
+        size_t packedBSize = B::KC * ((std::min(n, B::NC) + B::NR - 1) / B::NR * B::NR);
+        if (packedB.size() < packedBSize) {
+            packedB.resize(packedBSize, T());
+        }
+        for (size_t task = first; task < last; ++task) {
+            size_t p = task / blocks;
+            size_t ic = (task % blocks) * B::MC;
+            size_t mc = std::min(B::MC, m - ic);
+            T* cp = c + p * strideC;
+            for (size_t i = ic; i < ic + mc; ++i) {
+                std::fill(cp + i * n, cp + i * n + n, T());
+            }
+            for (size_t jc = 0; jc < n; jc += B::NC) {
+                size_t nc = std::min(B::NC, n - jc);
+                for (size_t pc = 0; pc < k; pc += B::KC) {
+                    size_t kc = std::min(B::KC, k - pc);
+                    packB(b + p * strideB + pc * n + jc, n, kc, nc, packedB.begin());
+                    gemmBlock(kernel, ic, mc, nc, kc, a + p * strideA + pc, k, packedB.begin(), cp + jc, n,
+                              packedA.begin());
+                }
+            }
+        }
+    };
+    pool->parallelFor(batches * blocks, 1, body);
+}
+
+// dst (cols x rows) = transpose of src (rows x cols), copying square tiles
+// so that both the reads and the writes stay within a few cache lines
+template <typename T>
+void transpose(size_t rows, size_t cols, const T* src, size_t lds, T* dst, size_t ldd, ThreadPool* pool = nullptr) {
+    constexpr size_t tile = transposeTile<T>();
+    auto body = [&](size_t first, size_t last) {
+        for (size_t ib = first; ib < last; ++ib) {
+            size_t i0 = ib * tile;
+            size_t i1 = std::min(i0 + tile, rows);
+            for (size_t j0 = 0; j0 < cols; j0 += tile) {
+                size_t j1 = std::min(j0 + tile, cols);
+                for (size_t i = i0; i < i1; ++i) {
+                    for (size_t j = j0; j < j1; ++j) {
+                        dst[j * ldd + i] = src[i * lds + j];
+                    }
+                }
+            }
+        }
+    };
+    size_t blocks = (rows + tile - 1) / tile;
+    if (pool) {
+        pool->parallelFor(blocks, 1, body);
+    } else {
+        body(0, blocks);
+    }
+}
+
+}  // namespace linalg
+
+// Matrix product of 2D arrays (m x k times k x n), or of batches of them
+// (b x m x k times b x k x n, or times one k x n matrix shared by the batch)
+template <typename T>
+NDArray<T> matmul(const NDArray<T>& a, const NDArray<T>& b, ThreadPool* pool = nullptr) {
+    bool batched = a.rank() == 3;
+    if ((a.rank() != 2 && a.rank() != 3) || (b.rank() != 2 && b.rank() != a.rank())) {
+        throw std::invalid_argument("matmul takes 2D matrices or 3D batches of them.");
+    }
+    size_t batches = batched ? a.dim(0) : 1;
+    size_t m = a.dim(a.rank() - 2), k = a.dim(a.rank() - 1);
+    size_t n = b.dim(b.rank() - 1);
+    if (b.dim(b.rank() - 2) != k || (b.rank() == 3 && b.dim(0) != batches)) {
+        throw std::invalid_argument("matmul operand shapes do not match.");
+    }
+
+    Vector<size_t> dims;
+    if (batched) {
+        dims.push_back(batches);
+    }
+    dims.push_back(m);
+    dims.push_back(n);
+    NDArray<T> c(dims);
+    size_t strideB = b.rank() == 3 ? k * n : 0;
+    linalg::gemmBatched(batches, m, n, k, a.rawData(), m * k, b.rawData(), strideB, c.rawData(), m * n, pool);
+    return c;
+}
+
+// Transpose of a 2D array, or of each matrix in a 3D batch
+template <typename T>
+NDArray<T> transposed(const NDArray<T>& a, ThreadPool* pool = nullptr) {
+    if (a.rank() != 2 && a.rank() != 3) {
+        throw std::invalid_argument("transposed takes 2D matrices or 3D batches of them.");
+    }
+    bool batched = a.rank() == 3;
+    size_t batches = batched ? a.dim(0) : 1;
+    size_t rows = a.dim(a.rank() - 2), cols = a.dim(a.rank() - 1);
+
+    Vector<size_t> dims;
+    if (batched) {
+        dims.push_back(batches);
+    }
+    dims.push_back(cols);
+    dims.push_back(rows);
+    NDArray<T> t(dims);
+    for (size_t i = 0; i < batches; ++i) {
+        linalg::transpose(rows, cols, a.rawData() + i * rows * cols, cols, t.rawData() + i * rows * cols, rows, pool);
+    }
+    return t;
+}
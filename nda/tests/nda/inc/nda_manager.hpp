@@ -0,0 +1,211 @@
+#pragma once
+
+#include "nda.hpp"
+#include "nda_parallel.hpp"
+#include "nda_simd.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+// Alignment of the arena and of every array in it: a cache line, and the
+// width of the widest SIMD registers
+#define NDA_ARENA_ALIGNMENT 64
+
+// NDArrayManager Class
+//
+// Holds `x` arrays of one shape in a single aligned allocation, array i
+// starting at element i * arrayStride. arrayStride is the array size
+// rounded up to a whole number of NDA_ARENA_ALIGNMENT bytes, so each array
+// starts on its own cache line and no two threads share one. Batched
+// operations split the arrays over a ThreadPool and run the SIMD kernels
+// on each.
+template <typename T>
+class NDArrayManager {
+private:
+    Vector<size_t> dimensions;  // Shape of every array
+    size_t count = 0;           // Number of arrays
+    size_t arraySize = 0;       // Elements per array
+    size_t arrayStride = 0;     // Elements from one array to the next
+    T* arena = nullptr;         // count * arrayStride elements
+    ThreadPool* pool;
+
+    // Arrays per task, enough that each task touches about 64 KiB
+    size_t grain() const {
+        return std::max<size_t>(1, (64 * 1024) / std::max<size_t>(1, arraySize * sizeof(T)));
+    }
+
+    void release() {
+        if (!arena) {
+            return;
+        }
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            for (size_t i = 0; i < count * arrayStride; ++i) {
+                arena[i].~T();
+            }
+        }
+        ::operator delete(arena, std::align_val_t(NDA_ARENA_ALIGNMENT));
+        arena = nullptr;
+    }
+
+    void checkShape(const NDArrayManager& other) const {
+        if (other.count != count || other.arraySize != arraySize) {
+            throw std::invalid_argument("Array managers do not match.");
+        }
+    }
+
+public:
+    // Constructor to initialize x NDArray instances with given dimensions.
+    // The arena is first touched by the pool's threads, which on NUMA
+    // machines places pages near the threads that later work on them.
+    NDArrayManager(size_t x, const std::initializer_list<size_t>& dims, ThreadPool& threads = ThreadPool::shared())
+        : count(x), arraySize(1), pool(&threads) {
+        static_assert(NDA_ARENA_ALIGNMENT % alignof(T) == 0, "Element alignment exceeds the arena alignment.");
+        for (auto dim : dims) {
+            dimensions.push_back(dim);
+            arraySize *= dim;
+        }
+        size_t perLine = std::max<size_t>(1, NDA_ARENA_ALIGNMENT / sizeof(T));
+        arrayStride = (arraySize + perLine - 1) / perLine * perLine;
+        if (count * arrayStride == 0) {
+            return;
+        }
+        arena = static_cast<T*>(::operator new(count * arrayStride * sizeof(T), std::align_val_t(NDA_ARENA_ALIGNMENT)));
+        pool->parallelFor(count, grain(), [this](size_t begin, size_t end) {
+            std::uninitialized_fill(arena + begin * arrayStride, arena + end * arrayStride, T());
+        });
+    }
+
+    NDArrayManager(const NDArrayManager&) = delete;
+    NDArrayManager& operator=(const NDArrayManager&) = delete;
+
+    NDArrayManager(NDArrayManager&& other) noexcept
+        : dimensions(std::move(other.dimensions)), count(std::exchange(other.count, 0)), arraySize(other.arraySize),
+          arrayStride(other.arrayStride), arena(std::exchange(other.arena, nullptr)), pool(other.pool) {}
+
+    ~NDArrayManager() {
+        release();
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    // Access individual NDArray by index, as a view into the arena
+    NDArrayView<T> getArray(size_t index) {
+        if (index >= count) {
+            throw std::out_of_range("Index out of range for array manager.");
+        }
+        return NDArrayView<T>(arena + index * arrayStride, dimensions.size(), dimensions.begin());
+    }
+
+    NDArrayView<const T> getArray(size_t index) const {
+        if (index >= count) {
+            throw std::out_of_range("Index out of range for array manager.");
+        }
+        return NDArrayView<const T>(arena + index * arrayStride, dimensions.size(), dimensions.begin());
+    }
+
+    // All arrays as one view with a leading batch axis
+    NDArrayView<T> batch() {
+        size_t dims[NDA_MAX_RANK];
+        ptrdiff_t strides[NDA_MAX_RANK];
+        if (dimensions.size() + 1 > NDA_MAX_RANK) {
+            throw std::invalid_argument("Rank exceeds NDA_MAX_RANK.");
+        }
+        dims[0] = count;
+        strides[0] = static_cast<ptrdiff_t>(arrayStride);
+        ptrdiff_t step = 1;
+        for (size_t i = dimensions.size(); i-- > 0;) {
+            dims[i + 1] = dimensions[i];
+            strides[i + 1] = step;
+            step *= static_cast<ptrdiff_t>(dimensions[i]);
+        }
+        return NDArrayView<T>(arena, dimensions.size() + 1, dims, strides);
+    }
+
+    // Sets every element of every array
+    void fill(const T& value) {
+        pool->parallelFor(count, grain(), [&](size_t begin, size_t end) {
+            std::fill(arena + begin * arrayStride, arena + end * arrayStride, value);
+        });
+    }
+
+    // Multiplies every element of every array by `factor`
+    void scale(const T& factor) {
+        const simd::Kernels<T>& kernels = simd::kernels<T>();
+        pool->parallelFor(count, grain(), [&](size_t begin, size_t end) {
+            T* first = arena + begin * arrayStride;
+            kernels.mulScalar(first, factor, first, (end - begin) * arrayStride);
+        });
+    }
+
+    // Adds the arrays of `other` to these, array by array
+    void add(const NDArrayManager& other) {
+        checkShape(other);
+        const simd::Kernels<T>& kernels = simd::kernels<T>();
+        pool->parallelFor(count, grain(), [&](size_t begin, size_t end) {
+            size_t offset = begin * arrayStride;
+            kernels.add(arena + offset, other.arena + offset, arena + offset, (end - begin) * arrayStride);
+        });
+    }
+
+    // Replaces every element with f(element)
+    template <typename F>
+    void transform(F f) {
+        pool->parallelFor(count, grain(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                T* values = arena + i * arrayStride;
+                for (size_t j = 0; j < arraySize; ++j) {
+                    values[j] = f(values[j]);
+                }
+            }
+        });
+    }
+
+    // Calls f(index, view) for every array, in parallel
+    template <typename F>
+    void forEachArray(F f) {
+        pool->parallelFor(count, grain(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                f(i, getArray(i));
+            }
+        });
+    }
+
+    // Sum of each array
+    Vector<T> sums() const {
+        Vector<T> result;
+        result.resize(count, T());
+        T* out = result.begin();
+        const simd::Kernels<T>& kernels = simd::kernels<T>();
+        pool->parallelFor(count, grain(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                out[i] = kernels.sum(arena + i * arrayStride, arraySize);
+            }
+        });
+        return result;
+    }
+
+    // Sum over all arrays
+    T sum() const {
+        T total = T();
+        for (const T& value : sums()) {
+            total += value;
+        }
+        return total;
+    }
+
+    // Print all arrays (for debugging purposes)
+    void printAll() const {
+        for (size_t i = 0; i < count; ++i) {
+            std::cout << "Array " << i + 1 << ": ";
+            getArray(i).print();
+        }
+    }
+};
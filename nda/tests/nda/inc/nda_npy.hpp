@@ -0,0 +1,297 @@
+#pragma once
+
+#include "nda.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// NumPy .npy files.
+//
+// A file is the magic "\x93NUMPY", a version, a header length and an ASCII
+// Python dict giving the dtype, whether the data is in Fortran (column-major)
+// order, and the shape, followed by the raw elements:
+//
+//   {'descr': '<f4', 'fortran_order': False, 'shape': (2, 3), }
+//
+// saveNpy writes version 1.0 files with the header padded so the data starts
+// on a 64-byte boundary. MappedNpy maps a file instead of reading it, so
+// opening costs the same for any size and pages are read on first touch.
+// Fortran-order files map to a view with column-major strides.
+
+#define NPY_MAGIC "\x93NUMPY"
+#define NPY_MAGIC_SIZE 6
+#define NPY_ALIGNMENT 64
+
+// dtype descriptor of T, little-endian ('|' where byte order does not apply)
+template <typename T>
+const char* npyDescr() {
+    static_assert(std::is_arithmetic_v<T>, "Only arithmetic element types have a NumPy dtype.");
+    if constexpr (std::is_same_v<T, bool>) {
+        return "|b1";
+    } else if constexpr (std::is_floating_point_v<T>) {
+        static_assert(sizeof(T) == 4 || sizeof(T) == 8, "Unsupported floating point size.");
+        return sizeof(T) == 4 ? "<f4" : "<f8";
+    } else if constexpr (std::is_signed_v<T>) {
+        switch (sizeof(T)) {
+        case 1: return "|i1";
+        case 2: return "<i2";
+        case 4: return "<i4";
+        default: return "<i8";
+        }
+    } else {
+        switch (sizeof(T)) {
+        case 1: return "|u1";
+        case 2: return "<u2";
+        case 4: return "<u4";
+        default: return "<u8";
+        }
+    }
+}
+
+namespace npy_detail {
+
+// Version 1.0 header with the given shape, padded to NPY_ALIGNMENT
+template <typename T>
+std::string header(const size_t* dims, size_t rank, bool fortranOrder) {
+    std::string dict = std::string("{'descr': '") + npyDescr<T>() + "', 'fortran_order': " +
+                       (fortranOrder ? "True" : "False") + ", 'shape': (";
+    for (size_t i = 0; i < rank; ++i) {
+        dict += std::to_string(dims[i]);
+        dict += rank == 1 ? "," : (i + 1 < rank ? ", " : "");
+    }
+    dict += "), }";
+
+    size_t unpadded = NPY_MAGIC_SIZE + 2 + 2 + dict.size() + 1;
+    dict.append((NPY_ALIGNMENT - unpadded % NPY_ALIGNMENT) % NPY_ALIGNMENT, ' ');
+    dict += '\n';
+    if (dict.size() > UINT16_MAX) {
+        throw std::length_error("NPY header too long.");
+    }
+
+    std::string out(NPY_MAGIC, NPY_MAGIC_SIZE);
+    out += '\x01';
+    out += '\x00';
+    out += static_cast<char>(dict.size() & 0xff);
+    out += static_cast<char>(dict.size() >> 8);
+    return out + dict;
+}
+
+// Value following 'key': in a header dict, up to the end of that value
+inline std::string field(const std::string& dict, const std::string& key) {
+    size_t pos = dict.find("'" + key + "'");
+    if (pos == std::string::npos || (pos = dict.find(':', pos)) == std::string::npos) {
+        throw std::runtime_error("NPY header has no " + key + ".");
+    }
+    pos = dict.find_first_not_of(' ', pos + 1);
+    size_t end = dict[pos] == '(' ? dict.find(')', pos) + 1 : dict.find_first_of(",}", dict[pos] == '\'' ? dict.find('\'', pos + 1) : pos);
+    return dict.substr(pos, end - pos);
+}
+
+}  // namespace npy_detail
+
+// Writes the elements of a view in row-major order, in one write when the
+// view is contiguous
+template <typename T>
+void saveNpy(const std::string& path, NDArrayView<const T> view) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Cannot open " + path + " for writing.");
+    }
+    size_t dims[NDA_MAX_RANK];
+    for (size_t i = 0; i < view.rank(); ++i) {
+        dims[i] = view.dim(i);
+    }
+    std::string header = npy_detail::header<std::remove_const_t<T>>(dims, view.rank(), false);
+    out.write(header.data(), header.size());
+
+    if (view.isContiguous()) {
+        out.write(reinterpret_cast<const char*>(view.base()), view.size() * sizeof(T));
+    } else {
+        // Gather strided elements through a fixed buffer
+        constexpr size_t chunk = 4096;
+        std::remove_const_t<T> buffer[chunk];
+        size_t used = 0;
+        view.forEach([&](const T& value) {
+            buffer[used++] = value;
+            if (used == chunk) {
+                out.write(reinterpret_cast<const char*>(buffer), sizeof(buffer));
+                used = 0;
+            }
+        });
+        out.write(reinterpret_cast<const char*>(buffer), used * sizeof(T));
+    }
+    if (!out.flush()) {
+        throw std::runtime_error("Failed writing " + path + ".");
+    }
+}
+
+// Mutable views, e.g. a.view().transpose(), which do not deduce T above
+template <typename T>
+void saveNpy(const std::string& path, NDArrayView<T> view) {
+    saveNpy<std::remove_const_t<T>>(path, NDArrayView<const T>(view));
+}
+
+template <typename T>
+void saveNpy(const std::string& path, const NDArray<T>& array) {
+    saveNpy<T>(path, array.view());
+}
+
+// How a .npy file is mapped
+enum class NpyMode {
+    ReadOnly,     // Shared read-only pages
+    CopyOnWrite,  // Writable; changes stay private to this mapping
+    ReadWrite     // Writable; changes go to the file
+};
+
+// A .npy file mapped into memory, viewed as elements of T. Read-only
+// mappings take a const T. The view is valid while the MappedNpy is alive.
+template <typename T>
+class MappedNpy {
+private:
+    void* mapping = MAP_FAILED;
+    size_t mappedSize = 0;
+    NDArrayView<T> elements;
+
+    void unmap() {
+        if (mapping != MAP_FAILED) {
+            munmap(mapping, mappedSize);
+            mapping = MAP_FAILED;
+        }
+    }
+
+public:
+    explicit MappedNpy(const std::string& path, NpyMode mode = std::is_const_v<T> ? NpyMode::ReadOnly : NpyMode::CopyOnWrite) {
+        if (mode == NpyMode::ReadOnly && !std::is_const_v<T>) {
+            throw std::invalid_argument("Read-only mappings must be viewed as const elements.");
+        }
+        int fd = ::open(path.c_str(), mode == NpyMode::ReadWrite ? O_RDWR : O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open " + path + ".");
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < NPY_MAGIC_SIZE + 4) {
+            ::close(fd);
+            throw std::runtime_error(path + " is not an NPY file.");
+        }
+        mappedSize = static_cast<size_t>(st.st_size);
+        int prot = mode == NpyMode::ReadOnly ? PROT_READ : PROT_READ | PROT_WRITE;
+        int flags = mode == NpyMode::CopyOnWrite ? MAP_PRIVATE : MAP_SHARED;
+        mapping = mmap(nullptr, mappedSize, prot, flags, fd, 0);
+        ::close(fd);  // The mapping keeps the file open
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Cannot map " + path + ".");
+        }
+        try {
+            parse(path);
+        } catch (...) {
+            unmap();
+            throw;
+        }
+    }
+
+    MappedNpy(const MappedNpy&) = delete;
+    MappedNpy& operator=(const MappedNpy&) = delete;
+
+    MappedNpy(MappedNpy&& other) noexcept
+        : mapping(std::exchange(other.mapping, MAP_FAILED)), mappedSize(other.mappedSize), elements(other.elements) {}
+
+    ~MappedNpy() {
+        unmap();
+    }
+
+    NDArrayView<T> view() const {
+        return elements;
+    }
+
+    // Contiguous in-memory copy, e.g. to outlive the mapping
+    NDArray<std::remove_const_t<T>> load() const {
+        return NDArray<std::remove_const_t<T>>(elements);
+    }
+
+private:
+    void parse(const std::string& path) {
+        const char* bytes = static_cast<const char*>(mapping);
+        if (std::memcmp(bytes, NPY_MAGIC, NPY_MAGIC_SIZE) != 0) {
+            throw std::runtime_error(path + " is not an NPY file.");
+        }
+        unsigned major = static_cast<unsigned char>(bytes[6]);
+        size_t headerLength = 0;
+        size_t dataOffset = 0;
+        if (major == 1) {
+            headerLength = static_cast<unsigned char>(bytes[8]) | static_cast<unsigned char>(bytes[9]) << 8;
+            dataOffset = 10 + headerLength;
+        } else if (major == 2 || major == 3) {
+            if (mappedSize < 12) {
+                throw std::runtime_error(path + " is truncated.");
+            }
+            uint32_t length;
+            std::memcpy(&length, bytes + 8, sizeof(length));
+            headerLength = length;
+            dataOffset = 12 + headerLength;
+        } else {
+            throw std::runtime_error(path + " has unsupported NPY version " + std::to_string(major) + ".");
+        }
+        if (dataOffset > mappedSize) {
+            throw std::runtime_error(path + " is truncated.");
+        }
+        std::string dict(bytes + dataOffset - headerLength, headerLength);
+
+        std::string descr = npy_detail::field(dict, "descr");
+        std::string expected = std::string("'") + npyDescr<std::remove_const_t<T>>() + "'";
+        if (descr != expected) {
+            throw std::runtime_error(path + " holds " + descr + ", not " + expected + ".");
+        }
+        bool fortranOrder = npy_detail::field(dict, "fortran_order") == "True";
+
+        std::string shapeText = npy_detail::field(dict, "shape");
+        size_t dims[NDA_MAX_RANK];
+        size_t rank = 0;
+        size_t total = 1;
+        for (size_t pos = 1; pos < shapeText.size();) {
+            size_t digits = shapeText.find_first_of("0123456789", pos);
+            if (digits == std::string::npos) {
+                break;
+            }
+            if (rank == NDA_MAX_RANK) {
+                throw std::runtime_error(path + " has more than NDA_MAX_RANK dimensions.");
+            }
+            size_t end = shapeText.find_first_not_of("0123456789", digits);
+            dims[rank] = std::stoull(shapeText.substr(digits, end - digits));
+            total *= dims[rank++];
+            pos = end;
+        }
+        if (mappedSize - dataOffset < total * sizeof(T)) {
+            throw std::runtime_error(path + " is truncated.");
+        }
+
+        T* base = reinterpret_cast<T*>(static_cast<char*>(mapping) + dataOffset);
+        if (!fortranOrder) {
+            elements = NDArrayView<T>(base, rank, dims);
+            return;
+        }
+        // Column-major: the first axis varies fastest
+        ptrdiff_t strides[NDA_MAX_RANK];
+        ptrdiff_t step = 1;
+        for (size_t i = 0; i < rank; ++i) {
+            strides[i] = step;
+            step *= static_cast<ptrdiff_t>(dims[i]);
+        }
+        elements = NDArrayView<T>(base, rank, dims, strides);
+    }
+};
+
+// Reads a .npy file into a new array
+template <typename T>
+NDArray<T> loadNpy(const std::string& path) {
+    return MappedNpy<const T>(path).load();
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of worker threads for data-parallel loops. parallelFor splits
+// a range into chunks that the workers and the calling thread claim from a
+// shared counter, so uneven chunks balance themselves. One loop runs at a
+// time; concurrent callers wait their turn.
+class ThreadPool {
+private:
+    struct Loop {
+        const std::function<void(size_t, size_t)>* body;
+        size_t count;
+        size_t grain;
+        std::atomic<size_t> next{0};
+        unsigned users = 0;             // Workers inside run(), guarded by mutex
+        std::exception_ptr error;       // First exception thrown by body, guarded by mutex
+    };
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::mutex loopMutex;  // Serializes parallelFor callers
+    std::condition_variable wake;
+    std::condition_variable done;
+    Loop* current = nullptr;
+    uint64_t generation = 0;
+    bool stopping = false;
+
+    void run(Loop& loop) {
+        try {
+            for (size_t begin = loop.next.fetch_add(loop.grain); begin < loop.count;
+                 begin = loop.next.fetch_add(loop.grain)) {
+                (*loop.body)(begin, std::min(begin + loop.grain, loop.count));
+            }
+        } catch (...) {
+            loop.next = loop.count;  // Stop handing out chunks
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!loop.error) {
+                loop.error = std::current_exception();
+            }
+        }
+    }
+
+    void work() {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [&] { return stopping || (current && generation != seen); });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            Loop* loop = current;
+            ++loop->users;
+            lock.unlock();
+            run(*loop);
+            lock.lock();
+            --loop->users;
+            done.notify_all();
+        }
+    }
+
+public:
+    // `threads` counts the calling thread, so a pool of 1 runs loops inline
+    explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency()) {
+        for (unsigned i = 1; i < threads; ++i) {
+            workers.emplace_back([this] { work(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Threads a loop runs on, including the caller
+    unsigned size() const {
+        return static_cast<unsigned>(workers.size()) + 1;
+    }
+
+    // Calls body(begin, end) for chunks of at most `grain` indices covering
+    // [0, count) and returns once all have run. The first exception thrown
+    // by body is rethrown here. body must not call parallelFor on this pool.
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body) {
+        grain = std::max<size_t>(grain, 1);
+        if (count <= grain || workers.empty()) {
+            for (size_t begin = 0; begin < count; begin += grain) {
+                body(begin, std::min(begin + grain, count));
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> serialize(loopMutex);
+        Loop loop;
+        loop.body = &body;
+        loop.count = count;
+        loop.grain = grain;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current = &loop;
+            ++generation;
+        }
+        wake.notify_all();
+        run(loop);
+
+        // Stop workers from joining, then wait for the ones still inside
+        std::unique_lock<std::mutex> lock(mutex);
+        current = nullptr;
+        done.wait(lock, [&] { return loop.users == 0; });
+        if (loop.error) {
+            std::rethrow_exception(loop.error);
+        }
+    }
+
+    // Process-wide pool with one thread per hardware thread
+    static ThreadPool& shared() {
+        static ThreadPool pool;
+        return pool;
+    }
+};
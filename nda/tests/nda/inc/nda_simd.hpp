@@ -0,0 +1,405 @@
+#pragma once
+
+#include "nda.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NDA_SIMD_X86 1
+#endif
+
+// Elementwise and reduction kernels over contiguous storage.
+//
+// Every kernel has a scalar version for any T. For float there are also
+// SSE, AVX2 (with FMA) and AVX-512 versions, compiled with per-function
+// target attributes so the rest of the program needs no -m flags, and
+// picked at runtime from what the CPU supports. Loops run several
+// independent accumulators so reductions are limited by memory bandwidth
+// rather than by the latency of one dependency chain.
+
+namespace simd {
+
+enum class Level { Scalar, SSE, AVX2, AVX512 };
+
+inline const char* levelName(Level level) {
+    switch (level) {
+    case Level::SSE: return "sse";
+    case Level::AVX2: return "avx2";
+    case Level::AVX512: return "avx512";
+    default: return "scalar";
+    }
+}
+
+// Portable kernels, also the reference the vector versions are checked against
+namespace scalar {
+
+template <typename T>
+void add(const T* a, const T* b, T* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+template <typename T>
+void mul(const T* a, const T* b, T* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = a[i] * b[i];
+    }
+}
+
+// out = a * b + c
+template <typename T>
+void fma(const T* a, const T* b, const T* c, T* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = a[i] * b[i] + c[i];
+    }
+}
+
+template <typename T>
+void addScalar(const T* a, T value, T* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = a[i] + value;
+    }
+}
+
+template <typename T>
+void mulScalar(const T* a, T value, T* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = a[i] * value;
+    }
+}
+
+template <typename T>
+T sum(const T* a, size_t n) {
+    T total = T();
+    for (size_t i = 0; i < n; ++i) {
+        total += a[i];
+    }
+    return total;
+}
+
+// min and max of an empty range are undefined; callers check n > 0
+template <typename T>
+T min(const T* a, size_t n) {
+    T result = a[0];
+    for (size_t i = 1; i < n; ++i) {
+        result = a[i] < result ? a[i] : result;
+    }
+    return result;
+}
+
+template <typename T>
+T max(const T* a, size_t n) {
+    T result = a[0];
+    for (size_t i = 1; i < n; ++i) {
+        result = a[i] > result ? a[i] : result;
+    }
+    return result;
+}
+
+template <typename T>
+T dot(const T* a, const T* b, size_t n) {
+    T total = T();
+    for (size_t i = 0; i < n; ++i) {
+        total += a[i] * b[i];
+    }
+    return total;
+}
+
+}  // namespace scalar
+
+// Kernel table for one element type at one level
+template <typename T>
+struct Kernels {
+    void (*add)(const T*, const T*, T*, size_t);
+    void (*mul)(const T*, const T*, T*, size_t);
+    void (*fma)(const T*, const T*, const T*, T*, size_t);
+    void (*addScalar)(const T*, T, T*, size_t);
+    void (*mulScalar)(const T*, T, T*, size_t);
+    T (*sum)(const T*, size_t);
+    T (*min)(const T*, size_t);
+    T (*max)(const T*, size_t);
+    T (*dot)(const T*, const T*, size_t);
+};
+
+template <typename T>
+const Kernels<T>& scalarKernels() {
+    static const Kernels<T> kernels = {scalar::add<T>, scalar::mul<T>, scalar::fma<T>, scalar::addScalar<T>,
+                                       scalar::mulScalar<T>, scalar::sum<T>, scalar::min<T>, scalar::max<T>,
+                                       scalar::dot<T>};
+    return kernels;
+}
+
+#ifdef NDA_SIMD_X86
+
+// Stamps out the float kernels for one instruction set. VEC is the vector
+// type, W its width in floats, and the remaining arguments name the
+// intrinsics (or small wrappers) for each operation. Tails shorter than one
+// vector run the scalar loop.
+#define NDA_SIMD_FLOAT_KERNELS(NS, TARGET, VEC, W, LOAD, STORE, SET1, ADD, MUL, FMADD, MIN, MAX)           \
+    namespace NS {                                                                                          \
+    TARGET inline void add(const float* a, const float* b, float* out, size_t n) {                          \
+        size_t i = 0;                                                                                       \
+        for (; i + W <= n; i += W) {                                                                        \
+            STORE(out + i, ADD(LOAD(a + i), LOAD(b + i)));                                                  \
+        }                                                                                                   \
+        scalar::add(a + i, b + i, out + i, n - i);                                                          \
+    }                                                                                                       \
+    TARGET inline void mul(const float* a, const float* b, float* out, size_t n) {                          \
+        size_t i = 0;                                                                                       \
+        for (; i + W <= n; i += W) {                                                                        \
+            STORE(out + i, MUL(LOAD(a + i), LOAD(b + i)));                                                  \
+        }                                                                                                   \
+        scalar::mul(a + i, b + i, out + i, n - i);                                                          \
+    }                                                                                                       \
+    TARGET inline void fma(const float* a, const float* b, const float* c, float* out, size_t n) {          \
+        size_t i = 0;                                                                                       \
+        for (; i + W <= n; i += W) {                                                                        \
+            STORE(out + i, FMADD(LOAD(a + i), LOAD(b + i), LOAD(c + i)));                                   \
+        }                                                                                                   \
+        scalar::fma(a + i, b + i, c + i, out + i, n - i);                                                   \
+    }                                                                                                       \
+    TARGET inline void addScalar(const float* a, float value, float* out, size_t n) {                       \
+        VEC v = SET1(value);                                                                                \
+        size_t i = 0;                                                                                       \
+        for (; i + W <= n; i += W) {                                                                        \
+            STORE(out + i, ADD(LOAD(a + i), v));                                                            \
+        }                                                                                                   \
+        scalar::addScalar(a + i, value, out + i, n - i);                                                    \
+    }                                                                                                       \
+    TARGET inline void mulScalar(const float* a, float value, float* out, size_t n) {                       \
+        VEC v = SET1(value);                                                                                \
+        size_t i = 0;                                                                                       \
+        for (; i + W <= n; i += W) {                                                                        \
+            STORE(out + i, MUL(LOAD(a + i), v));                                                            \
+        }                                                                                                   \
+        scalar::mulScalar(a + i, value, out + i, n - i);                                                    \
+    }                                                                                                       \
+    /* Folds a vector into a scalar through memory; runs once per call */                                   \
+    TARGET inline float fold(VEC v, float (*op)(float, float)) {                                            \
+        alignas(64) float lanes[W];                                                                         \
+        STORE(lanes, v);                                                                                    \
+        float result = lanes[0];                                                                            \
+        for (size_t i = 1; i < W; ++i) {                                                                    \
+            result = op(result, lanes[i]);                                                                  \
+        }                                                                                                   \
+        return result;                                                                                      \
+    }                                                                                                       \
+    TARGET inline float sum(const float* a, size_t n) {                                                     \
+        VEC s0 = SET1(0.0f), s1 = s0, s2 = s0, s3 = s0;                                                     \
+        size_t i = 0;                                                                                       \
+        for (; i + 4 * W <= n; i += 4 * W) {                                                                \
+            s0 = ADD(s0, LOAD(a + i));                                                                      \
+            s1 = ADD(s1, LOAD(a + i + W));                                                                  \
+            s2 = ADD(s2, LOAD(a + i + 2 * W));                                                              \
+            s3 = ADD(s3, LOAD(a + i + 3 * W));                                                              \
+        }                                                                                                   \
+        for (; i + W <= n; i += W) {                                                                        \
+            s0 = ADD(s0, LOAD(a + i));                                                                      \
+        }                                                                                                   \
+        VEC total = ADD(ADD(s0, s1), ADD(s2, s3));                                                          \
+        return fold(total, [](float x, float y) { return x + y; }) + scalar::sum(a + i, n - i);             \
+    }                                                                                                       \
+    TARGET inline float dot(const float* a, const float* b, size_t n) {                                     \
+        VEC s0 = SET1(0.0f), s1 = s0, s2 = s0, s3 = s0;                                                     \
+        size_t i = 0;                                                                                       \
+        for (; i + 4 * W <= n; i += 4 * W) {                                                                \
+            s0 = FMADD(LOAD(a + i), LOAD(b + i), s0);                                                       \
+            s1 = FMADD(LOAD(a + i + W), LOAD(b + i + W), s1);                                               \
+            s2 = FMADD(LOAD(a + i + 2 * W), LOAD(b + i + 2 * W), s2);                                       \
+            s3 = FMADD(LOAD(a + i + 3 * W), LOAD(b + i + 3 * W), s3);                                       \
+        }                                                                                                   \
+        for (; i + W <= n; i += W) {                                                                        \
+            s0 = FMADD(LOAD(a + i), LOAD(b + i), s0);                                                       \
+        }                                                                                                   \
+        VEC total = ADD(ADD(s0, s1), ADD(s2, s3));                                                          \
+        return fold(total, [](float x, float y) { return x + y; }) + scalar::dot(a + i, b + i, n - i);      \
+    }                                                                                                       \
+    TARGET inline float min(const float* a, size_t n) {                                                     \
+        if (n < W) {                                                                                        \
+            return scalar::min(a, n);                                                                       \
+        }                                                                                                   \
+        VEC m0 = LOAD(a), m1 = m0;                                                                          \
+        size_t i = W;                                                                                       \
+        for (; i + 2 * W <= n; i += 2 * W) {                                                                \
+            m0 = MIN(m0, LOAD(a + i));                                                                      \
+            m1 = MIN(m1, LOAD(a + i + W));                                                                  \
+        }                                                                                                   \
+        float result = fold(MIN(m0, m1), [](float x, float y) { return y < x ? y : x; });                   \
+        return i < n ? std::min(result, scalar::min(a + i, n - i)) : result;                                \
+    }                                                                                                       \
+    TARGET inline float max(const float* a, size_t n) {                                                     \
+        if (n < W) {                                                                                        \
+            return scalar::max(a, n);                                                                       \
+        }                                                                                                   \
+        VEC m0 = LOAD(a), m1 = m0;                                                                          \
+        size_t i = W;                                                                                       \
+        for (; i + 2 * W <= n; i += 2 * W) {                                                                \
+            m0 = MAX(m0, LOAD(a + i));                                                                      \
+            m1 = MAX(m1, LOAD(a + i + W));                                                                  \
+        }                                                                                                   \
+        float result = fold(MAX(m0, m1), [](float x, float y) { return y > x ? y : x; });                   \
+        return i < n ? std::max(result, scalar::max(a + i, n - i)) : result;                                \
+    }                                                                                                       \
+    inline const Kernels<float>& kernels() {                                                                \
+        static const Kernels<float> table = {add, mul, fma, addScalar, mulScalar, sum, min, max, dot};      \
+        return table;                                                                                       \
+    }                                                                                                       \
+    }
+
+#define NDA_TARGET_SSE __attribute__((target("sse4.1")))
+#define NDA_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define NDA_TARGET_AVX512 __attribute__((target("avx512f")))
+
+// SSE has no fused multiply-add
+NDA_TARGET_SSE inline __m128 sseMulAdd(__m128 a, __m128 b, __m128 c) {
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+}
+
+NDA_SIMD_FLOAT_KERNELS(sse, NDA_TARGET_SSE, __m128, 4, _mm_loadu_ps, _mm_storeu_ps, _mm_set1_ps, _mm_add_ps,
+                       _mm_mul_ps, sseMulAdd, _mm_min_ps, _mm_max_ps)
+NDA_SIMD_FLOAT_KERNELS(avx2, NDA_TARGET_AVX2, __m256, 8, _mm256_loadu_ps, _mm256_storeu_ps, _mm256_set1_ps,
+                       _mm256_add_ps, _mm256_mul_ps, _mm256_fmadd_ps, _mm256_min_ps, _mm256_max_ps)
+// GCC's AVX-512 headers trip -Wmaybe-uninitialized through _mm512_undefined_ps
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+NDA_SIMD_FLOAT_KERNELS(avx512, NDA_TARGET_AVX512, __m512, 16, _mm512_loadu_ps, _mm512_storeu_ps, _mm512_set1_ps,
+                       _mm512_add_ps, _mm512_mul_ps, _mm512_fmadd_ps, _mm512_min_ps, _mm512_max_ps)
+#pragma GCC diagnostic pop
+
+#endif  // NDA_SIMD_X86
+
+// Best level this CPU supports, detected on the first call only since
+// kernels() and setLevel() consult it on every call
+inline Level detectLevel() {
+    static const Level detected = [] {
+#ifdef NDA_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return Level::AVX512;
+        }
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            return Level::AVX2;
+        }
+        if (__builtin_cpu_supports("sse4.1")) {
+            return Level::SSE;
+        }
+#endif
+        return Level::Scalar;
+    }();
+    return detected;
+}
+
+inline Level& activeLevelRef() {
+    static Level level = detectLevel();
+    return level;
+}
+
+inline Level activeLevel() {
+    return activeLevelRef();
+}
+
+// Forces a lower level, e.g. to compare against the scalar kernels. Levels
+// above what the CPU supports are clamped. Not thread-safe; set it before
+// running kernels.
+inline void setLevel(Level level) {
+    activeLevelRef() = std::min(level, detectLevel());
+}
+
+// Kernels for T at the active level. Only float has vector versions.
+template <typename T>
+const Kernels<T>& kernels(Level level = activeLevel()) {
+#ifdef NDA_SIMD_X86
+    if constexpr (std::is_same_v<T, float>) {
+        switch (std::min(level, detectLevel())) {
+        case Level::AVX512: return avx512::kernels();
+        case Level::AVX2: return avx2::kernels();
+        case Level::SSE: return sse::kernels();
+        default: break;
+        }
+    }
+#endif
+    (void)level;
+    return scalarKernels<T>();
+}
+
+}  // namespace simd
+
+// Elementwise operations and reductions on whole NDArrays
+
+template <typename T>
+void checkSameShape(const NDArray<T>& a, const NDArray<T>& b) {
+    if (!a.sameShape(b)) {
+        throw std::invalid_argument("NDArray shapes do not match.");
+    }
+}
+
+// out = a + b; `out` may be `a` or `b`
+template <typename T>
+void add(const NDArray<T>& a, const NDArray<T>& b, NDArray<T>& out) {
+    checkSameShape(a, b);
+    checkSameShape(a, out);
+    simd::kernels<T>().add(a.rawData(), b.rawData(), out.rawData(), a.size());
+}
+
+// out = a * b
+template <typename T>
+void mul(const NDArray<T>& a, const NDArray<T>& b, NDArray<T>& out) {
+    checkSameShape(a, b);
+    checkSameShape(a, out);
+    simd::kernels<T>().mul(a.rawData(), b.rawData(), out.rawData(), a.size());
+}
+
+// out = a * b + c
+template <typename T>
+void multiplyAdd(const NDArray<T>& a, const NDArray<T>& b, const NDArray<T>& c, NDArray<T>& out) {
+    checkSameShape(a, b);
+    checkSameShape(a, c);
+    checkSameShape(a, out);
+    simd::kernels<T>().fma(a.rawData(), b.rawData(), c.rawData(), out.rawData(), a.size());
+}
+
+// out = a + value, for every element
+template <typename T>
+void addScalar(const NDArray<T>& a, T value, NDArray<T>& out) {
+    checkSameShape(a, out);
+    simd::kernels<T>().addScalar(a.rawData(), value, out.rawData(), a.size());
+}
+
+// out = a * value, for every element
+template <typename T>
+void mulScalar(const NDArray<T>& a, T value, NDArray<T>& out) {
+    checkSameShape(a, out);
+    simd::kernels<T>().mulScalar(a.rawData(), value, out.rawData(), a.size());
+}
+
+template <typename T>
+T sum(const NDArray<T>& a) {
+    return simd::kernels<T>().sum(a.rawData(), a.size());
+}
+
+template <typename T>
+T minValue(const NDArray<T>& a) {
+    if (a.size() == 0) {
+        throw std::logic_error("Minimum of an empty NDArray.");
+    }
+    return simd::kernels<T>().min(a.rawData(), a.size());
+}
+
+template <typename T>
+T maxValue(const NDArray<T>& a) {
+    if (a.size() == 0) {
+        throw std::logic_error("Maximum of an empty NDArray.");
+    }
+    return simd::kernels<T>().max(a.rawData(), a.size());
+}
+
+template <typename T>
+T dot(const NDArray<T>& a, const NDArray<T>& b) {
+    checkSameShape(a, b);
+    return simd::kernels<T>().dot(a.rawData(), b.rawData(), a.size());
+}
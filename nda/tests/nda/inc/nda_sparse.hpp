@@ -0,0 +1,398 @@
+#pragma once
+
+#include "nda.hpp"
+#include "nda_simd.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iostream>
+#include <stdexcept>
+
+// Sparse NDArrays, storing only the nonzero elements.
+//
+// Writes go to a COO buffer of (row-major offset, value) entries, so
+// setValue is an append. Before any read the buffer is sorted and merged
+// into CSF (compressed sparse fiber) form: one level per axis, where level l
+// holds the axis-l coordinate of every distinct prefix (i0, ..., il) and,
+// above the last level, the range of its children in level l + 1. The last
+// level lines up with the values. For a matrix this is CSR with empty rows
+// left out. A lookup is one binary search per axis, and kernels walk the
+// levels in row-major order, touching only stored elements.
+//
+// Reads compress pending writes first, so build with setValue, call
+// compress() (or any read) once, then read; concurrent const reads are safe
+// only after that.
+
+template <typename T>
+class SparseNDArray {
+private:
+    struct Entry {
+        size_t offset;  // Row-major offset into the dense array
+        T value;
+    };
+
+    Vector<size_t> dimensions;                  // Dimensions of the n-dimensional array
+    Vector<size_t> strides;                     // Row-major strides of the dense array
+    size_t totalSize = 1;                       // Elements of the dense array
+    mutable Vector<Entry> pending;              // COO writes not yet compressed
+    mutable Vector<size_t> fiberIndices[NDA_MAX_RANK];   // Coordinates per level
+    mutable Vector<size_t> fiberPointers[NDA_MAX_RANK];  // Child ranges, all but the last level
+    mutable Vector<T> values;                   // One per last-level node
+
+    void setShape(const size_t* dims, size_t rank) {
+        if (rank == 0 || rank > NDA_MAX_RANK) {
+            throw std::invalid_argument("Rank must be between 1 and NDA_MAX_RANK.");
+        }
+        dimensions.clear();
+        for (size_t i = 0; i < rank; ++i) {
+            dimensions.push_back(dims[i]);
+        }
+        strides.resize(rank, 0);
+        totalSize = 1;
+        for (size_t i = rank; i-- > 0;) {
+            strides[i] = totalSize;
+            if (dims[i] != 0 && totalSize > SIZE_MAX / dims[i]) {
+                throw std::invalid_argument("Sparse NDArray has more elements than a size_t can index.");
+            }
+            totalSize *= dims[i];
+        }
+    }
+
+    // Helper function to calculate the row-major offset of indices
+    size_t calculateIndex(const Vector<size_t>& indices) const {
+        if (indices.size() != dimensions.size()) {
+            throw std::out_of_range("Incorrect number of indices.");
+        }
+        size_t index = 0;
+        for (size_t i = 0; i < dimensions.size(); ++i) {
+            if (indices[i] >= dimensions[i]) {
+                throw std::out_of_range("Index out of range.");
+            }
+            index += indices[i] * strides[i];
+        }
+        return index;
+    }
+
+    // Rebuilds the levels from entries sorted by offset, dropping zeros
+    void build(const Vector<Entry>& entries) const {
+        size_t rank = dimensions.size();
+        for (size_t l = 0; l < rank; ++l) {
+            fiberIndices[l].clear();
+            fiberPointers[l].clear();
+        }
+        values.clear();
+
+        size_t previous[NDA_MAX_RANK];
+        bool first = true;
+        for (const Entry& entry : entries) {
+            if (entry.value == T()) {
+                continue;
+            }
+            size_t coords[NDA_MAX_RANK];
+            size_t rest = entry.offset;
+            for (size_t l = 0; l < rank; ++l) {
+                coords[l] = rest / strides[l];
+                rest %= strides[l];
+            }
+            // Levels from the first axis that differs from the previous entry get a new node
+            size_t level = 0;
+            while (!first && level + 1 < rank && coords[level] == previous[level]) {
+                ++level;
+            }
+            for (size_t l = level; l < rank; ++l) {
+                fiberIndices[l].push_back(coords[l]);
+                if (l + 1 < rank) {
+                    fiberPointers[l].push_back(fiberIndices[l + 1].size());
+                }
+                previous[l] = coords[l];
+            }
+            values.push_back(entry.value);
+            first = false;
+        }
+        for (size_t l = 0; l + 1 < rank; ++l) {
+            fiberPointers[l].push_back(fiberIndices[l + 1].size());
+        }
+    }
+
+    // Calls f(coords, offset, node) for every stored element, in row-major order
+    template <typename F>
+    void walk(size_t level, size_t begin, size_t end, size_t offset, size_t* coords, F& f) const {
+        const size_t* indices = fiberIndices[level].begin();
+        bool last = level + 1 == dimensions.size();
+        for (size_t node = begin; node < end; ++node) {
+            coords[level] = indices[node];
+            size_t at = offset + indices[node] * strides[level];
+            if (last) {
+                f(static_cast<const size_t*>(coords), at, node);
+            } else {
+                walk(level + 1, fiberPointers[level][node], fiberPointers[level][node + 1], at, coords, f);
+            }
+        }
+    }
+
+    template <typename F>
+    void walk(F f) const {
+        compress();
+        size_t coords[NDA_MAX_RANK];
+        walk(0, 0, fiberIndices[0].size(), 0, coords, f);
+    }
+
+    // Rebuilds the levels without the zeros that rewriting values in place
+    // left behind; a scan when there are none
+    void dropZeros() {
+        if (std::find(values.begin(), values.end(), T()) == values.end()) {
+            return;
+        }
+        Vector<Entry> stored;
+        stored.reserve(values.size());
+        walk([&](const size_t*, size_t offset, size_t node) { stored.push_back(Entry{offset, values[node]}); });
+        build(stored);
+    }
+
+public:
+    // Constructor to initialize an empty (all zero) array with given dimensions
+    SparseNDArray(const std::initializer_list<size_t>& dims) {
+        setShape(dims.begin(), dims.size());
+        build(Vector<Entry>());
+    }
+
+    explicit SparseNDArray(const Vector<size_t>& dims) {
+        setShape(dims.begin(), dims.size());
+        build(Vector<Entry>());
+    }
+
+    // The nonzero elements of a dense view
+    template <typename U>
+    explicit SparseNDArray(const NDArrayView<U>& source) {
+        size_t dims[NDA_MAX_RANK];
+        for (size_t i = 0; i < source.rank(); ++i) {
+            dims[i] = source.dim(i);
+        }
+        setShape(dims, source.rank());
+        // forEach visits in row-major order, so entries arrive sorted
+        Vector<Entry> entries;
+        size_t offset = 0;
+        source.forEach([&](const U& value) {
+            if (value != U()) {
+                entries.push_back(Entry{offset, static_cast<T>(value)});
+            }
+            ++offset;
+        });
+        build(entries);
+    }
+
+    explicit SparseNDArray(const NDArray<T>& dense) : SparseNDArray(dense.view()) {}
+
+    // Sorts pending writes, keeping the last write to each element, and
+    // merges them into the compressed levels
+    void compress() const {
+        if (pending.size() == 0) {
+            return;
+        }
+        std::stable_sort(pending.begin(), pending.end(),
+                         [](const Entry& a, const Entry& b) { return a.offset < b.offset; });
+
+        Vector<Entry> stored;
+        stored.reserve(values.size());
+        size_t coords[NDA_MAX_RANK];
+        auto collect = [&](const size_t*, size_t offset, size_t node) { stored.push_back(Entry{offset, values[node]}); };
+        walk(0, 0, fiberIndices[0].size(), 0, coords, collect);
+
+        Vector<Entry> merged;
+        merged.reserve(stored.size() + pending.size());
+        size_t i = 0;
+        size_t j = 0;
+        while (i < stored.size() || j < pending.size()) {
+            if (j == pending.size() || (i < stored.size() && stored[i].offset < pending[j].offset)) {
+                merged.push_back(stored[i++]);
+                continue;
+            }
+            size_t offset = pending[j].offset;
+            while (j + 1 < pending.size() && pending[j + 1].offset == offset) {
+                ++j;
+            }
+            merged.push_back(pending[j++]);
+            if (i < stored.size() && stored[i].offset == offset) {
+                ++i;  // Overwritten
+            }
+        }
+        pending.clear();
+        build(merged);
+    }
+
+    size_t rank() const {
+        return dimensions.size();
+    }
+
+    const Vector<size_t>& shape() const {
+        return dimensions;
+    }
+
+    size_t dim(size_t axis) const {
+        return dimensions[axis];
+    }
+
+    // Function to get the size of the n-dimensional array, zeros included
+    size_t size() const {
+        return totalSize;
+    }
+
+    // Number of stored elements
+    size_t nonZeros() const {
+        compress();
+        return values.size();
+    }
+
+    // Bytes held by the compressed levels and values
+    size_t storageBytes() const {
+        compress();
+        size_t bytes = values.size() * sizeof(T);
+        for (size_t l = 0; l < dimensions.size(); ++l) {
+            bytes += (fiberIndices[l].size() + fiberPointers[l].size()) * sizeof(size_t);
+        }
+        return bytes;
+    }
+
+    // True if the dense array `other` has the same dimensions
+    bool sameShape(const NDArray<T>& other) const {
+        if (other.rank() != dimensions.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < dimensions.size(); ++i) {
+            if (other.dim(i) != dimensions[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Function to set a value at specific indices; setting zero removes the element
+    void setValue(const Vector<size_t>& indices, const T& value) {
+        pending.push_back(Entry{calculateIndex(indices), value});
+    }
+
+    // Function to get a value at specific indices
+    T getValue(const Vector<size_t>& indices) const {
+        calculateIndex(indices);  // Checks the indices
+        compress();
+        size_t begin = 0;
+        size_t end = fiberIndices[0].size();
+        for (size_t l = 0; l < dimensions.size(); ++l) {
+            const size_t* first = fiberIndices[l].begin() + begin;
+            const size_t* last = fiberIndices[l].begin() + end;
+            const size_t* found = std::lower_bound(first, last, indices[l]);
+            if (found == last || *found != indices[l]) {
+                return T();
+            }
+            size_t node = found - fiberIndices[l].begin();
+            if (l + 1 == dimensions.size()) {
+                return values[node];
+            }
+            begin = fiberPointers[l][node];
+            end = fiberPointers[l][node + 1];
+        }
+        return T();
+    }
+
+    // Calls f(coords, value) for every stored element in row-major order,
+    // coords holding rank() indices
+    template <typename F>
+    void forEachNonZero(F f) const {
+        walk([&](const size_t* coords, size_t, size_t node) { f(coords, values[node]); });
+    }
+
+    // Calls f(offset, value) with the row-major offset of every stored element
+    template <typename F>
+    void forEachOffset(F f) const {
+        walk([&](const size_t*, size_t offset, size_t node) { f(offset, values[node]); });
+    }
+
+    // Stored values in row-major order, e.g. for reductions
+    const T* valueData() const {
+        compress();
+        return values.begin();
+    }
+
+    // Multiplies every element by `factor`
+    void scale(const T& factor) {
+        compress();
+        simd::kernels<T>().mulScalar(values.begin(), factor, values.begin(), values.size());
+        dropZeros();
+    }
+
+    // Copy with each stored value replaced by f(offset, value); elements f
+    // maps to zero are dropped
+    template <typename F>
+    SparseNDArray transformed(F f) const {
+        compress();
+        SparseNDArray out(*this);
+        T* outValues = out.values.begin();
+        forEachOffset([&](size_t offset, const T& value) { *outValues++ = f(offset, value); });
+        out.dropZeros();
+        return out;
+    }
+
+    // Dense copy
+    NDArray<T> toDense() const {
+        NDArray<T> dense(dimensions);
+        T* out = dense.rawData();
+        forEachOffset([out](size_t offset, const T& value) { out[offset] = value; });
+        return dense;
+    }
+
+    // Function to print the stored elements (for debugging purposes)
+    void print() const {
+        forEachNonZero([this](const size_t* coords, const T& value) {
+            std::cout << "(";
+            for (size_t i = 0; i < dimensions.size(); ++i) {
+                std::cout << coords[i] << (i + 1 < dimensions.size() ? "," : "");
+            }
+            std::cout << ")=" << value << " ";
+        });
+        std::cout << std::endl;
+    }
+};
+
+// Kernels between sparse and dense arrays, costing O(nonzeros)
+
+template <typename T>
+void checkSameShape(const SparseNDArray<T>& a, const NDArray<T>& b) {
+    if (!a.sameShape(b)) {
+        throw std::invalid_argument("NDArray shapes do not match.");
+    }
+}
+
+template <typename T>
+T sum(const SparseNDArray<T>& a) {
+    return simd::kernels<T>().sum(a.valueData(), a.nonZeros());
+}
+
+template <typename T>
+T dot(const SparseNDArray<T>& a, const NDArray<T>& b) {
+    checkSameShape(a, b);
+    const T* dense = b.rawData();
+    T total = T();
+    a.forEachOffset([&](size_t offset, const T& value) { total += value * dense[offset]; });
+    return total;
+}
+
+// out = a + b; `out` may be `a`
+template <typename T>
+void add(const NDArray<T>& a, const SparseNDArray<T>& b, NDArray<T>& out) {
+    checkSameShape(b, a);
+    checkSameShape(b, out);
+    if (&out != &a) {
+        std::copy(a.rawData(), a.rawData() + a.size(), out.rawData());
+    }
+    T* dense = out.rawData();
+    b.forEachOffset([dense](size_t offset, const T& value) { dense[offset] += value; });
+}
+
+// a * b elementwise, which is nonzero only where a is
+template <typename T>
+SparseNDArray<T> mul(const SparseNDArray<T>& a, const NDArray<T>& b) {
+    checkSameShape(a, b);
+    const T* dense = b.rawData();
+    return a.transformed([dense](size_t offset, const T& value) { return value * dense[offset]; });
+}
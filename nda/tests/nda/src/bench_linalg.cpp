@@ -0,0 +1,141 @@
+#include "../inc/nda.hpp"
+#include "../inc/nda_linalg.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+
+// Times the blocked matrix product and transpose against the naive loops.
+//
+//   bench_linalg [--size N] [--batch B] [--threads T] [--reps R]
+//
+// Multiplies B pairs of N x N float matrices and reports GFLOP/s (2 * N^3
+// flops per product) for the naive i-k-j loop, the blocked product on one
+// thread and the blocked product on T threads, then GB/s for the naive and
+// tiled transposes. Results are checked against the naive product.
+
+using Clock = std::chrono::steady_clock;
+
+// Best of `reps` runs, in seconds
+template <typename F>
+double best(size_t reps, F f) {
+    double fastest = 1e300;
+    for (size_t r = 0; r < reps; ++r) {
+        auto start = Clock::now();
+        f();
+        fastest = std::min(fastest, std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    return fastest;
+}
+
+// Row-major C = A * B with the inner loop running along rows of B and C
+void naiveMatmul(size_t n, const float* a, const float* b, float* c) {
+    std::fill(c, c + n * n, 0.0f);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t k = 0; k < n; ++k) {
+            float aik = a[i * n + k];
+            for (size_t j = 0; j < n; ++j) {
+                c[i * n + j] += aik * b[k * n + j];
+            }
+        }
+    }
+}
+
+void naiveTranspose(size_t n, const float* src, float* dst) {
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            dst[j * n + i] = src[i * n + j];
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t n = 1024;
+    size_t batch = 1;
+    size_t reps = 3;
+    unsigned threads = std::thread::hardware_concurrency();
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        size_t value = std::strtoull(argv[i + 1], nullptr, 10);
+        if (flag == "--size") {
+            n = value;
+        } else if (flag == "--batch") {
+            batch = value;
+        } else if (flag == "--threads") {
+            threads = static_cast<unsigned>(value);
+        } else if (flag == "--reps") {
+            reps = value;
+        } else {
+            std::cerr << "Unknown flag " << flag << std::endl;
+            return 2;
+        }
+    }
+    if (n == 0 || batch == 0 || reps == 0 || threads == 0) {
+        std::cerr << "Sizes, threads and reps must be positive." << std::endl;
+        return 2;
+    }
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    NDArray<float> a({batch, n, n});
+    NDArray<float> b({batch, n, n});
+    for (size_t i = 0; i < a.size(); ++i) {
+        a.rawData()[i] = dist(rng);
+        b.rawData()[i] = dist(rng);
+    }
+    NDArray<float> naive({batch, n, n});
+    ThreadPool pool(threads);
+
+    double flops = 2.0 * static_cast<double>(n) * n * n * batch;
+    double bytes = 2.0 * sizeof(float) * n * n * batch;
+    std::cout << "float " << batch << " x " << n << "x" << n << ", simd " << simd::levelName(simd::activeLevel())
+              << ", " << pool.size() << " threads" << std::endl;
+
+    double naiveTime = best(reps, [&] {
+        for (size_t p = 0; p < batch; ++p) {
+            naiveMatmul(n, a.rawData() + p * n * n, b.rawData() + p * n * n, naive.rawData() + p * n * n);
+        }
+    });
+    NDArray<float> blocked = matmul(a, b);
+    double blockedTime = best(reps, [&] { blocked = matmul(a, b); });
+    NDArray<float> parallel = matmul(a, b, &pool);
+    double parallelTime = best(reps, [&] { parallel = matmul(a, b, &pool); });
+
+    double error = 0.0;
+    for (size_t i = 0; i < naive.size(); ++i) {
+        error = std::max<double>(error, std::fabs(naive.rawData()[i] - blocked.rawData()[i]));
+        error = std::max<double>(error, std::fabs(naive.rawData()[i] - parallel.rawData()[i]));
+    }
+
+    std::printf("matmul   naive        %8.2f GFLOP/s\n", flops / naiveTime * 1e-9);
+    std::printf("matmul   blocked      %8.2f GFLOP/s  (%.1fx)\n", flops / blockedTime * 1e-9, naiveTime / blockedTime);
+    std::printf("matmul   blocked x%-3u %8.2f GFLOP/s  (%.1fx)\n", pool.size(), flops / parallelTime * 1e-9,
+                naiveTime / parallelTime);
+    std::printf("max abs error vs naive: %g\n", error);
+
+    NDArray<float> t({batch, n, n});
+    double naiveTransposeTime = best(reps, [&] {
+        for (size_t p = 0; p < batch; ++p) {
+            naiveTranspose(n, a.rawData() + p * n * n, t.rawData() + p * n * n);
+        }
+    });
+    // Into the same preallocated output as the naive loop
+    auto tiled = [&](ThreadPool* threads) {
+        for (size_t p = 0; p < batch; ++p) {
+            linalg::transpose(n, n, a.rawData() + p * n * n, n, t.rawData() + p * n * n, n, threads);
+        }
+    };
+    double tiledTransposeTime = best(reps, [&] { tiled(nullptr); });
+    double parallelTransposeTime = best(reps, [&] { tiled(&pool); });
+    std::printf("transpose naive       %8.2f GB/s\n", bytes / naiveTransposeTime * 1e-9);
+    std::printf("transpose tiled       %8.2f GB/s\n", bytes / tiledTransposeTime * 1e-9);
+    std::printf("transpose tiled x%-3u  %8.2f GB/s\n", pool.size(), bytes / parallelTransposeTime * 1e-9);
+
+    return error <= 1e-3 * n ? 0 : 1;
+}
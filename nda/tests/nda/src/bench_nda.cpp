@@ -0,0 +1,227 @@
+#include "../inc/nda.hpp"
+#include "../inc/nda_manager.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+// Microbenchmarks for the nda containers, printed as one JSON array.
+//
+//   bench_nda [--min-bytes B] [--max-bytes B] [--budget-ms M]
+//
+// Each benchmark runs on float data from --min-bytes (default 4 KiB) to
+// --max-bytes (default 1 GiB), growing 16x per step. Arrays are shaped
+// {n / 1024, 32, 32}. Every case is repeated until about --budget-ms
+// (default 200) has passed and the fastest run is reported, as ns per
+// element and as GB/s over the bytes each element reads and writes:
+//
+//   {"benchmark": "ndarray_get_random", "bytes": 4096, "elements": 1024,
+//    "ns_per_element": 3.1, "gb_per_s": 1.29}
+
+using Clock = std::chrono::steady_clock;
+
+// Keeps results alive so the compiler cannot drop the loops producing them
+volatile float sink;
+
+struct Options {
+    size_t minBytes = 4096;
+    size_t maxBytes = size_t(1) << 30;
+    double budgetSeconds = 0.2;
+};
+
+class Report {
+private:
+    bool first = true;
+
+public:
+    Report() {
+        std::printf("[\n");
+    }
+
+    ~Report() {
+        std::printf("\n]\n");
+    }
+
+    // `elements` of an array of `arrayElements` took `seconds`, each costing
+    // `bytesPerElement` of memory traffic
+    void add(const char* name, size_t arrayElements, size_t elements, double seconds, size_t bytesPerElement) {
+        std::printf("%s  {\"benchmark\": \"%s\", \"bytes\": %zu, \"elements\": %zu, \"ns_per_element\": %.4f, "
+                    "\"gb_per_s\": %.3f}",
+                    first ? "" : ",\n", name, arrayElements * sizeof(float), elements, seconds * 1e9 / elements,
+                    static_cast<double>(elements) * bytesPerElement / seconds * 1e-9);
+        std::fflush(stdout);
+        first = false;
+    }
+};
+
+// Fastest of repeated runs of f, repeated until the budget is spent
+template <typename F>
+double best(const Options& options, F f) {
+    double fastest = 1e300;
+    double spent = 0.0;
+    for (int run = 0; run < 1000 && (run < 2 || spent < options.budgetSeconds); ++run) {
+        auto start = Clock::now();
+        f();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        fastest = std::min(fastest, seconds);
+        spent += seconds;
+    }
+    return fastest;
+}
+
+void benchVector(const Options& options, Report& report, size_t n) {
+    report.add("vector_push_back", n, n, best(options, [&] {
+        Vector<float> values;
+        for (size_t i = 0; i < n; ++i) {
+            values.push_back(static_cast<float>(i));
+        }
+        sink = values[n - 1];
+    }), sizeof(float));
+    report.add("vector_push_back_reserved", n, n, best(options, [&] {
+        Vector<float> values;
+        values.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            values.push_back(static_cast<float>(i));
+        }
+        sink = values[n - 1];
+    }), sizeof(float));
+}
+
+void benchNDArray(const Options& options, Report& report, size_t n) {
+    size_t planes = n / 1024;
+    report.add("ndarray_construct", n, n, best(options, [&] {
+        NDArray<float> array({planes, 32, 32});
+        sink = array.rawData()[n - 1];
+    }), sizeof(float));
+
+    NDArray<float> array({planes, 32, 32});
+    for (size_t i = 0; i < n; ++i) {
+        array.rawData()[i] = static_cast<float>(i & 1023);
+    }
+    Vector<size_t> indices;
+    indices.resize(3, 0);
+
+    // Indices in row-major order, through getValue and so calculateIndex
+    report.add("ndarray_get_sequential", n, n, best(options, [&] {
+        float total = 0.0f;
+        for (size_t i = 0; i < planes; ++i) {
+            indices[0] = i;
+            for (size_t j = 0; j < 32; ++j) {
+                indices[1] = j;
+                for (size_t k = 0; k < 32; ++k) {
+                    indices[2] = k;
+                    total += array.getValue(indices);
+                }
+            }
+        }
+        sink = total;
+    }), sizeof(float));
+
+    report.add("ndarray_set_sequential", n, n, best(options, [&] {
+        for (size_t i = 0; i < planes; ++i) {
+            indices[0] = i;
+            for (size_t j = 0; j < 32; ++j) {
+                indices[1] = j;
+                for (size_t k = 0; k < 32; ++k) {
+                    indices[2] = k;
+                    array.setValue(indices, 1.0f);
+                }
+            }
+        }
+    }), sizeof(float));
+
+    // Up to 4M uniformly random elements, coordinates drawn up front
+    size_t lookups = std::min<size_t>(n, size_t(1) << 22);
+    Vector<uint32_t> coords;
+    coords.reserve(lookups * 3);
+    std::mt19937 rng(1);
+    for (size_t i = 0; i < lookups; ++i) {
+        coords.push_back(static_cast<uint32_t>(rng() % planes));
+        coords.push_back(static_cast<uint32_t>(rng() % 32));
+        coords.push_back(static_cast<uint32_t>(rng() % 32));
+    }
+    report.add("ndarray_get_random", n, lookups, best(options, [&] {
+        float total = 0.0f;
+        const uint32_t* at = coords.begin();
+        for (size_t i = 0; i < lookups; ++i, at += 3) {
+            indices[0] = at[0];
+            indices[1] = at[1];
+            indices[2] = at[2];
+            total += array.getValue(indices);
+        }
+        sink = total;
+    }), sizeof(float));
+
+    report.add("ndarray_iterate_raw", n, n, best(options, [&] {
+        const float* values = array.rawData();
+        float total = 0.0f;
+        for (size_t i = 0; i < n; ++i) {
+            total += values[i];
+        }
+        sink = total;
+    }), sizeof(float));
+
+    report.add("ndarray_iterate_view", n, n, best(options, [&] {
+        float total = 0.0f;
+        array.view().forEach([&](const float& value) { total += value; });
+        sink = total;
+    }), sizeof(float));
+
+    // Strided: the planes axis moves fastest
+    report.add("ndarray_iterate_transposed", n, n, best(options, [&] {
+        float total = 0.0f;
+        array.view().transpose().forEach([&](const float& value) { total += value; });
+        sink = total;
+    }), sizeof(float));
+}
+
+void benchManager(const Options& options, Report& report, size_t n) {
+    size_t count = n / 1024;
+    NDArrayManager<float> a(count, {32, 32});
+    NDArrayManager<float> b(count, {32, 32});
+    b.fill(1.0f);
+
+    report.add("manager_fill", n, n, best(options, [&] { a.fill(2.0f); }), sizeof(float));
+    report.add("manager_scale", n, n, best(options, [&] { a.scale(1.0f); }), 2 * sizeof(float));
+    report.add("manager_add", n, n, best(options, [&] { a.add(b); }), 3 * sizeof(float));
+    report.add("manager_sums", n, n, best(options, [&] { sink = a.sums()[0]; }), sizeof(float));
+    report.add("manager_transform", n, n, best(options, [&] { a.transform([](float v) { return v * 0.5f; }); }),
+               2 * sizeof(float));
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        double value = std::strtod(argv[i + 1], nullptr);
+        if (flag == "--min-bytes") {
+            options.minBytes = static_cast<size_t>(value);
+        } else if (flag == "--max-bytes") {
+            options.maxBytes = static_cast<size_t>(value);
+        } else if (flag == "--budget-ms") {
+            options.budgetSeconds = value / 1000.0;
+        } else {
+            std::cerr << "Unknown flag " << flag << std::endl;
+            return 2;
+        }
+    }
+    // Whole 32x32 float planes
+    options.minBytes = std::max<size_t>(options.minBytes, 1024 * sizeof(float));
+
+    Report report;
+    for (size_t bytes = options.minBytes; bytes <= options.maxBytes; bytes *= 16) {
+        size_t n = bytes / sizeof(float) / 1024 * 1024;
+        benchVector(options, report, n);
+        benchNDArray(options, report, n);
+        benchManager(options, report, n);
+        if (bytes > options.maxBytes / 16 && bytes < options.maxBytes) {
+            bytes = options.maxBytes / 16;  // End on exactly --max-bytes
+        }
+    }
+    return 0;
+}
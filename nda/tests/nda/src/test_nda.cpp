@@ -1,160 +1,447 @@
+#include "../inc/nda.hpp"
+#include "../inc/nda_expr.hpp"
+#include "../inc/nda_fixed.hpp"
+#include "../inc/nda_linalg.hpp"
+#include "../inc/nda_manager.hpp"
+#include "../inc/nda_npy.hpp"
+#include "../inc/nda_simd.hpp"
+#include "../inc/nda_sparse.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
-#include <stdexcept>
-#include <initializer_list>
-#include <memory>  // For std::unique_ptr
+#include <random>
+#include <vector>
 
-// Custom Vector class
-template <typename T>
-class Vector {
-private:
-    std::unique_ptr<T[]> data;  // Pointer to the data using unique_ptr for automatic cleanup
-    size_t capacity;            // Capacity of the vector
-    size_t currentSize;         // Current number of elements
+// Checks every SIMD level this CPU supports against the scalar kernels,
+// over lengths that exercise the unrolled loops, single vectors and tails.
+// Elementwise results must match exactly except for fma, which rounds once;
+// reductions add in a different order and are compared with a tolerance.
+bool checkSimdKernels() {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    const simd::Kernels<float>& reference = simd::scalarKernels<float>();
+    bool ok = true;
 
-    // Function to resize the vector when capacity is reached
-    void resize() {
-        capacity *= 2;
-        std::unique_ptr<T[]> newData = std::make_unique<T[]>(capacity);
-        for (size_t i = 0; i < currentSize; ++i) {
-            newData[i] = std::move(data[i]);  // Move the data to the new array
+    auto close = [](float expected, float actual, size_t n) {
+        return std::fabs(expected - actual) <= 1e-5f * static_cast<float>(n + 1);
+    };
+    auto report = [&](simd::Level level, const char* kernel, size_t n, bool passed) {
+        if (!passed) {
+            std::cout << "SIMD check failed: " << simd::levelName(level) << " " << kernel << " n=" << n << std::endl;
+            ok = false;
         }
-        data = std::move(newData);
-    }
+    };
 
-public:
-    // Constructor
-    Vector() : capacity(4), currentSize(0) {
-        data = std::make_unique<T[]>(capacity);
-    }
+    const simd::Level levels[] = {simd::Level::SSE, simd::Level::AVX2, simd::Level::AVX512};
+    for (simd::Level level : levels) {
+        if (level > simd::detectLevel()) {
+            continue;
+        }
+        const simd::Kernels<float>& kernels = simd::kernels<float>(level);
+        for (size_t n : {0, 1, 3, 4, 7, 8, 15, 16, 17, 31, 63, 64, 65, 100, 1000, 4099}) {
+            Vector<float> a, b, c, expected, actual;
+            for (size_t i = 0; i < n; ++i) {
+                a.push_back(dist(rng));
+                b.push_back(dist(rng));
+                c.push_back(dist(rng));
+            }
+            expected.resize(n, 0.0f);
+            actual.resize(n, 0.0f);
+
+            auto same = [&](bool exact) {
+                for (size_t i = 0; i < n; ++i) {
+                    if (exact ? expected[i] != actual[i] : !close(expected[i], actual[i], 1)) {
+                        return false;
+                    }
+                }
+                return true;
+            };
+            reference.add(a.begin(), b.begin(), expected.begin(), n);
+            kernels.add(a.begin(), b.begin(), actual.begin(), n);
+            report(level, "add", n, same(true));
+            reference.mul(a.begin(), b.begin(), expected.begin(), n);
+            kernels.mul(a.begin(), b.begin(), actual.begin(), n);
+            report(level, "mul", n, same(true));
+            reference.fma(a.begin(), b.begin(), c.begin(), expected.begin(), n);
+            kernels.fma(a.begin(), b.begin(), c.begin(), actual.begin(), n);
+            report(level, "fma", n, same(false));
+            reference.addScalar(a.begin(), 0.5f, expected.begin(), n);
+            kernels.addScalar(a.begin(), 0.5f, actual.begin(), n);
+            report(level, "addScalar", n, same(true));
+            reference.mulScalar(a.begin(), 3.0f, expected.begin(), n);
+            kernels.mulScalar(a.begin(), 3.0f, actual.begin(), n);
+            report(level, "mulScalar", n, same(true));
 
-    // Add an element to the vector
-    void push_back(const T& value) {
-        if (currentSize == capacity) {
-            resize();
+            report(level, "sum", n, close(reference.sum(a.begin(), n), kernels.sum(a.begin(), n), n));
+            report(level, "dot", n, close(reference.dot(a.begin(), b.begin(), n), kernels.dot(a.begin(), b.begin(), n), n));
+            if (n > 0) {
+                report(level, "min", n, reference.min(a.begin(), n) == kernels.min(a.begin(), n));
+                report(level, "max", n, reference.max(a.begin(), n) == kernels.max(a.begin(), n));
+            }
         }
-        data[currentSize++] = value;
     }
+    return ok;
+}
 
-    // Get the number of elements in the vector
-    size_t size() const {
-        return currentSize;
+// Checks the blocked matrix product and transpose against naive loops, on
+// shapes with partial micro-tiles and more than one KC and NC block, both
+// single-threaded and on the shared pool, alone and in batches
+bool checkMatmul() {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    const size_t shapes[][4] = {{1, 1, 1, 1}, {1, 7, 5, 3}, {3, 13, 17, 19}, {1, 97, 33, 300}, {1, 5, 2100, 9},
+                                {4, 200, 21, 300}, {2, 3, 2100, 5}};
+    bool ok = true;
+    for (const auto& shape : shapes) {
+        size_t batches = shape[0], m = shape[1], n = shape[2], k = shape[3];
+        NDArray<float> a({batches, m, k});
+        NDArray<float> b({batches, k, n});
+        for (size_t i = 0; i < a.size(); ++i) {
+            a.rawData()[i] = dist(rng);
+        }
+        for (size_t i = 0; i < b.size(); ++i) {
+            b.rawData()[i] = dist(rng);
+        }
+        for (ThreadPool* pool : {static_cast<ThreadPool*>(nullptr), &ThreadPool::shared()}) {
+            NDArray<float> c = matmul(a, b, pool);
+            NDArray<float> t = transposed(b, pool);
+            for (size_t p = 0; p < batches; ++p) {
+                for (size_t i = 0; i < m; ++i) {
+                    for (size_t j = 0; j < n; ++j) {
+                        float expected = 0.0f;
+                        for (size_t q = 0; q < k; ++q) {
+                            expected += a.rawData()[(p * m + i) * k + q] * b.rawData()[(p * k + q) * n + j];
+                        }
+                        if (std::fabs(expected - c.rawData()[(p * m + i) * n + j]) > 1e-5f * static_cast<float>(k + 1)) {
+                            ok = false;
+                        }
+                    }
+                }
+                for (size_t q = 0; q < k; ++q) {
+                    for (size_t j = 0; j < n; ++j) {
+                        if (t.rawData()[(p * n + j) * k + q] != b.rawData()[(p * k + q) * n + j]) {
+                            ok = false;
+                        }
+                    }
+                }
+            }
+        }
+        if (!ok) {
+            std::cout << "Matmul check failed: " << batches << "x" << m << "x" << n << "x" << k << std::endl;
+            return false;
+        }
     }
+    return true;
+}
 
-    // Access element by index
-    T& operator[](size_t index) {
-        if (index >= currentSize) {
-            throw std::out_of_range("Index out of range.");
+// Fused expressions against the same arithmetic in element loops, including
+// scalars on either side, negation, an expression reading the array it is
+// assigned to, and a shape mismatch
+bool checkExpressions() {
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> dist(0.5f, 2.0f);
+    NDArray<float> a({3, 5, 7}), b({3, 5, 7}), c({3, 5, 7});
+    for (size_t i = 0; i < a.size(); ++i) {
+        a.rawData()[i] = dist(rng);
+        b.rawData()[i] = dist(rng);
+        c.rawData()[i] = dist(rng);
+    }
+    bool ok = true;
+    auto expect = [&](const NDArray<float>& actual, auto expected, const char* what) {
+        bool same = actual.rank() == 3 && actual.dim(0) == 3 && actual.dim(1) == 5 && actual.dim(2) == 7;
+        for (size_t i = 0; same && i < a.size(); ++i) {
+            same = std::fabs(actual.rawData()[i] - expected(i)) <= 1e-6f * std::fabs(expected(i)) + 1e-6f;
+        }
+        if (!same) {
+            std::cout << "Expression check failed: " << what << std::endl;
+            ok = false;
         }
-        return data[index];
+    };
+    const float* pa = a.rawData();
+    const float* pb = b.rawData();
+    const float* pc = c.rawData();
+
+    NDArray<float> r = a * b + c * 2.0f - a / 4.0f;
+    expect(r, [&](size_t i) { return pa[i] * pb[i] + pc[i] * 2.0f - pa[i] / 4.0f; }, "a * b + c * 2 - a / 4");
+    r = 1.0f - -a + 3.0f * (b - c);
+    expect(r, [&](size_t i) { return 1.0f - -pa[i] + 3.0f * (pb[i] - pc[i]); }, "1 - -a + 3 * (b - c)");
+    expect(eval((a + b) / (c + 1.0f)), [&](size_t i) { return (pa[i] + pb[i]) / (pc[i] + 1.0f); }, "eval((a + b) / (c + 1))");
+    NDArray<float> before(a.view());
+    a = a * a - b;
+    expect(a, [&](size_t i) { return before.rawData()[i] * before.rawData()[i] - pb[i]; }, "a = a * a - b");
+
+    NDArray<float> other({3, 7, 5});
+    bool threw = false;
+    try {
+        NDArray<float> mismatched = a + other;
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    if (!threw) {
+        std::cout << "Expression check failed: mismatched shapes" << std::endl;
+        ok = false;
     }
+    return ok;
+}
 
-    // Access element by index (const version)
-    const T& operator[](size_t index) const {
-        if (index >= currentSize) {
-            throw std::out_of_range("Index out of range.");
+// Fixed-rank and static arrays address the same row-major elements as the
+// offsets they are laid out with, and at() rejects every out-of-range axis
+bool checkFixedRank() {
+    bool ok = true;
+    auto expect = [&](bool passed, const char* what) {
+        if (!passed) {
+            std::cout << "Fixed-rank check failed: " << what << std::endl;
+            ok = false;
         }
-        return data[index];
-    }
-};
+    };
+    auto outOfRange = [](auto access) {
+        try {
+            access();
+        } catch (const std::out_of_range&) {
+            return true;
+        }
+        return false;
+    };
 
-// NDArray Class
-template <typename T>
-class NDArray {
-private:
-    Vector<size_t> dimensions;  // Dimensions of the n-dimensional array
-    Vector<T> data;             // Flattened data storage
-
-    // Helper function to calculate index in the flattened array
-    size_t calculateIndex(const Vector<size_t>& indices) const {
-        if (indices.size() != dimensions.size()) {
-            throw std::out_of_range("Incorrect number of indices.");
-        }
-
-        size_t index = 0;
-        size_t offset = 1;
-        for (int i = dimensions.size() - 1; i >= 0; --i) {
-            if (indices[i] >= dimensions[i]) {
-                throw std::out_of_range("Index out of range.");
+    NDArray<int, 3> fixed(2, 3, 4);
+    StaticNDArray<int, 2, 3, 4> inlined;
+    bool indexed = true;
+    for (size_t i = 0; i < 2; ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+            for (size_t k = 0; k < 4; ++k) {
+                fixed(i, j, k) = static_cast<int>(i * 100 + j * 10 + k);
+                inlined(i, j, k) = static_cast<int>(i * 100 + j * 10 + k);
             }
-            index += indices[i] * offset;
-            offset *= dimensions[i];
         }
-        return index;
     }
+    for (size_t i = 0; i < 2; ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+            for (size_t k = 0; k < 4; ++k) {
+                int expected = static_cast<int>(i * 100 + j * 10 + k);
+                size_t offset = i * 12 + j * 4 + k;
+                indexed = indexed && fixed.rawData()[offset] == expected && inlined.rawData()[offset] == expected &&
+                          fixed.at(i, j, k) == expected && inlined.at(i, j, k) == expected;
+            }
+        }
+    }
+    expect(indexed, "row-major indexing");
+    expect(fixed.size() == 24 && inlined.size() == 24 && sizeof(inlined) == 24 * sizeof(int), "sizes");
+    expect(fixed.stride(0) == 12 && fixed.stride(1) == 4 && fixed.stride(2) == 1, "strides");
+    expect(StaticNDArray<int, 2, 3, 4>::strides[0] == 12 && StaticNDArray<int, 2, 3, 4>::strides[1] == 4, "static strides");
+    expect(outOfRange([&] { fixed.at(2, 0, 0); }) && outOfRange([&] { fixed.at(0, 3, 0); }) &&
+           outOfRange([&] { fixed.at(0, 0, 4); }), "fixed-rank bounds");
+    expect(outOfRange([&] { inlined.at(2, 0, 0); }) && outOfRange([&] { inlined.at(0, 3, 0); }) &&
+           outOfRange([&] { inlined.at(0, 0, 4); }), "static bounds");
+    expect(!outOfRange([&] { fixed.at(1, 2, 3); }) && !outOfRange([&] { inlined.at(1, 2, 3); }), "last element in bounds");
+    return ok;
+}
 
-public:
-    // Default constructor
-    NDArray() = default;
-
-    // Constructor to initialize the array with given dimensions
-    NDArray(const std::initializer_list<size_t>& dims) {
-        for (auto dim : dims) {
-            dimensions.push_back(dim);
+// COO writes compressed to CSF against the same writes to a dense array:
+// repeated coordinates keep the last write, zeros remove elements, writes
+// after a compress merge with what is stored, and whole slices, the first
+// and last planes among them, stay empty
+bool checkSparse() {
+    const size_t d0 = 6, d1 = 5, d2 = 7;
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<size_t> pick(0, d0 * d1 * d2 - 1);
+    std::uniform_int_distribution<int> value(-3, 3);  // Zero about one write in seven
+    SparseNDArray<float> sparse({d0, d1, d2});
+    NDArray<float> dense({d0, d1, d2});
+    bool ok = true;
+    auto expect = [&](bool passed, const char* what) {
+        if (!passed) {
+            std::cout << "Sparse check failed: " << what << std::endl;
+            ok = false;
         }
+    };
 
-        size_t totalSize = 1;
-        for (size_t i = 0; i < dimensions.size(); ++i) {
-            totalSize *= dimensions[i];
+    auto write = [&](size_t count) {
+        for (size_t w = 0; w < count; ++w) {
+            size_t offset = pick(rng);
+            size_t i = offset / (d1 * d2), j = offset / d2 % d1, k = offset % d2;
+            if (i == 0 || i == 3 || i == d0 - 1 || j == 2) {
+                continue;  // Planes 0, 3 and 5 and every row j = 2 stay empty
+            }
+            Vector<size_t> at;
+            at.push_back(i);
+            at.push_back(j);
+            at.push_back(k);
+            float v = static_cast<float>(value(rng));
+            sparse.setValue(at, v);
+            dense.rawData()[offset] = v;
+            if (w % 3 == 0) {  // Same coordinate again, last write wins
+                sparse.setValue(at, v + 10.0f);
+                dense.rawData()[offset] = v + 10.0f;
+            }
         }
-        for (size_t i = 0; i < totalSize; ++i) {
-            data.push_back(T());  // Initialize all elements to default value of T
+    };
+    auto matches = [&]() {
+        size_t stored = 0;
+        for (size_t offset = 0; offset < dense.size(); ++offset) {
+            stored += dense.rawData()[offset] != 0.0f;
         }
-    }
+        if (sparse.nonZeros() != stored) {
+            return false;
+        }
+        Vector<size_t> at;
+        at.resize(3, 0);
+        for (size_t i = 0; i < d0; ++i) {
+            for (size_t j = 0; j < d1; ++j) {
+                for (size_t k = 0; k < d2; ++k) {
+                    at[0] = i;
+                    at[1] = j;
+                    at[2] = k;
+                    if (sparse.getValue(at) != dense.rawData()[(i * d1 + j) * d2 + k]) {
+                        return false;
+                    }
+                }
+            }
+        }
+        NDArray<float> expanded = sparse.toDense();
+        if (!std::equal(expanded.rawData(), expanded.rawData() + expanded.size(), dense.rawData())) {
+            return false;
+        }
+        // Stored elements in strictly increasing row-major order, coordinates agreeing with offsets
+        bool ordered = true;
+        long previous = -1;
+        sparse.forEachNonZero([&](const size_t* coords, const float& v) {
+            long offset = static_cast<long>((coords[0] * d1 + coords[1]) * d2 + coords[2]);
+            ordered = ordered && offset > previous && v != 0.0f && dense.rawData()[offset] == v;
+            previous = offset;
+        });
+        return ordered;
+    };
 
-    // Function to set a value at specific indices
-    void setValue(const Vector<size_t>& indices, const T& value) {
-        data[calculateIndex(indices)] = value;
-    }
+    expect(sparse.nonZeros() == 0 && sum(sparse) == 0.0f && matches(), "empty array");
+    write(120);
+    expect(matches(), "first compress");
+    write(80);  // Merged with the stored elements, overwriting and zeroing some
+    expect(matches(), "merge after compress");
 
-    // Function to get a value at specific indices
-    T getValue(const Vector<size_t>& indices) const {
-        return data[calculateIndex(indices)];
+    NDArray<float> other({d0, d1, d2});
+    for (size_t i = 0; i < other.size(); ++i) {
+        other.rawData()[i] = static_cast<float>(i % 5) - 2.0f;
     }
-
-    // Function to get the size of the n-dimensional array
-    size_t size() const {
-        return data.size();
+    float expectedSum = 0.0f, expectedDot = 0.0f;
+    for (size_t i = 0; i < dense.size(); ++i) {
+        expectedSum += dense.rawData()[i];
+        expectedDot += dense.rawData()[i] * other.rawData()[i];
     }
-
-    // Function to print the data (for debugging purposes)
-    void print() const {
-        for (size_t i = 0; i < data.size(); ++i) {
-            std::cout << data[i] << " ";
-        }
-        std::cout << std::endl;
+    expect(sum(sparse) == expectedSum, "sum");
+    expect(dot(sparse, other) == expectedDot, "dot");
+    SparseNDArray<float> sparseProduct = mul(sparse, other);  // other is zero at every fifth offset
+    size_t productNonZeros = 0;
+    for (size_t i = 0; i < dense.size(); ++i) {
+        productNonZeros += dense.rawData()[i] * other.rawData()[i] != 0.0f;
+    }
+    expect(sparseProduct.nonZeros() == productNonZeros, "mul drops the zeros it produces");
+    NDArray<float> product = sparseProduct.toDense();
+    NDArray<float> total({d0, d1, d2});
+    add(other, sparse, total);
+    bool elementwise = true;
+    for (size_t i = 0; i < dense.size(); ++i) {
+        elementwise = elementwise && product.rawData()[i] == dense.rawData()[i] * other.rawData()[i] &&
+                      total.rawData()[i] == other.rawData()[i] + dense.rawData()[i];
     }
-};
+    expect(elementwise, "mul and add");
+    SparseNDArray<float> zeroed = sparse;
+    zeroed.scale(0.0f);
+    expect(zeroed.nonZeros() == 0 && zeroed.storageBytes() == 2 * sizeof(size_t), "scaling by zero drops every element");
+    return ok;
+}
 
-// NDArrayManager Class
+// Elements of a view in row-major order, for comparing views of any layout
 template <typename T>
-class NDArrayManager {
-private:
-    Vector<NDArray<T>> arrays;
+std::vector<std::remove_const_t<T>> elementsOf(NDArrayView<T> view) {
+    std::vector<std::remove_const_t<T>> values;
+    view.forEach([&](const T& value) { values.push_back(value); });
+    return values;
+}
 
-public:
-    // Constructor to initialize x NDArray instances with given dimensions
-    NDArrayManager(size_t x, const std::initializer_list<size_t>& dims) {
-        for (size_t i = 0; i < x; ++i) {
-            arrays.push_back(NDArray<T>(dims));
+template <typename A, typename B>
+bool sameShape(NDArrayView<A> a, NDArrayView<B> b) {
+    if (a.rank() != b.rank()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.rank(); ++i) {
+        if (a.dim(i) != b.dim(i)) {
+            return false;
         }
     }
+    return true;
+}
 
-    // Access individual NDArray by index
-    NDArray<T>& getArray(size_t index) {
-        if (index >= arrays.size()) {
-            throw std::out_of_range("Index out of range for array manager.");
+// Round trips through .npy files: a contiguous array, a strided mutable view
+// and a hand-written Fortran-order file, plus a dtype mismatch and the
+// difference between copy-on-write and read-write mappings
+bool checkNpy() {
+    const char* path = "nda_check.npy";
+    bool ok = true;
+    auto expect = [&](bool passed, const char* what) {
+        if (!passed) {
+            std::cout << "NPY check failed: " << what << std::endl;
+            ok = false;
         }
-        return arrays[index];
+    };
+
+    NDArray<float> a({3, 4, 5});
+    for (size_t i = 0; i < a.size(); ++i) {
+        a.rawData()[i] = static_cast<float>(i) * 0.5f - 7.0f;
     }
+    saveNpy(path, a);
+    NDArray<float> loaded = loadNpy<float>(path);
+    expect(sameShape(loaded.view(), a.view()) && elementsOf(loaded.view()) == elementsOf(a.view()), "C order");
 
-    // Print all arrays (for debugging purposes)
-    void printAll() const {
-        for (size_t i = 0; i < arrays.size(); ++i) {
-            std::cout << "Array " << i + 1 << ": ";
-            arrays[i].print();
-        }
+    NDArrayView<float> strided = a.view().slice(2, 0, 5, 2).transpose();
+    saveNpy(path, strided);
+    loaded = loadNpy<float>(path);
+    expect(sameShape(loaded.view(), strided) && elementsOf(loaded.view()) == elementsOf(strided), "strided view");
+
+    bool threw = false;
+    try {
+        loadNpy<double>(path);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    expect(threw, "dtype mismatch");
+
+    // 2x3 matrix stored column by column
+    {
+        const size_t dims[] = {2, 3};
+        const int32_t columns[] = {1, 4, 2, 5, 3, 6};
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        std::string header = npy_detail::header<int32_t>(dims, 2, true);
+        out.write(header.data(), header.size());
+        out.write(reinterpret_cast<const char*>(columns), sizeof(columns));
+    }
+    {
+        MappedNpy<const int32_t> fortran(path);
+        NDArray<int32_t> rows = fortran.load();
+        expect(fortran.view().stride(0) == 1 && fortran.view().stride(1) == 2, "Fortran order strides");
+        expect(rows.dim(0) == 2 && rows.dim(1) == 3 && elementsOf(rows.view()) == std::vector<int32_t>{1, 2, 3, 4, 5, 6},
+               "Fortran order");
     }
-};
+
+    // Writes through a copy-on-write mapping stay private; read-write ones
+    // reach the file
+    saveNpy(path, a);
+    {
+        MappedNpy<float> private_(path);
+        private_.view().base()[0] = 100.0f;
+        expect(private_.view().base()[0] == 100.0f, "copy-on-write mapping is writable");
+    }
+    expect(loadNpy<float>(path).rawData()[0] == a.rawData()[0], "copy-on-write leaves the file unchanged");
+    {
+        MappedNpy<float> shared(path, NpyMode::ReadWrite);
+        shared.view().base()[0] = 100.0f;
+    }
+    expect(loadNpy<float>(path).rawData()[0] == 100.0f, "read-write mapping updates the file");
+
+    std::remove(path);
+    return ok;
+}
 
 // Main function
 int main() {
@@ -185,5 +472,84 @@ int main() {
     // Print all arrays
     manager.printAll();
 
+    // Views share the array's elements: row 1 of the first array's first
+    // plane, and the whole first array transposed
+    NDArrayView<int> first = manager.getArray(0);
+    std::cout << "Row (0,1,:) of NDArray 1: ";
+    first.index(0, 0).index(0, 1).print();
+    std::cout << "Plane (1,:,:) of NDArray 1, transposed: ";
+    first.index(0, 1).transpose().print();
+
+    // Batched operations over every managed array at once
+    NDArrayManager<float> batch(1000, {8, 8});
+    batch.fill(1.0f);
+    batch.scale(2.0f);
+    batch.add(batch);
+    std::cout << "Batched sum over " << batch.size() << " arrays: " << batch.sum() << std::endl;
+
+    // With the rank fixed at compile time, indices are plain arguments
+    NDArray<int, 3> fixed(3, 3, 3);
+    fixed(1, 1, 1) = 40;
+    StaticNDArray<int, 3, 3, 3> inlined;
+    inlined(1, 1, 1) = 50;
+    std::cout << "Value at (1,1,1) in fixed-rank arrays: " << fixed.at(1, 1, 1) << " " << inlined(1, 1, 1) << std::endl;
+
+    // Arithmetic on whole arrays runs on the best SIMD level available
+    NDArray<float> u({4, 8});
+    NDArray<float> v({4, 8});
+    addScalar(u, 1.0f, u);
+    addScalar(v, 2.0f, v);
+    multiplyAdd(u, v, v, u);  // u = u * v + v = 4
+    std::cout << "SIMD level: " << simd::levelName(simd::activeLevel()) << ", sum: " << sum(u)
+              << ", dot: " << dot(u, v) << std::endl;
+
+    // Chained arithmetic is fused into one loop on assignment
+    NDArray<float> w = u * v + v * 2.0f - u / 4.0f;  // 4 * 2 + 2 * 2 - 1 = 11
+    std::cout << "Fused expression sum: " << sum(w) << std::endl;
+
+    // Blocked matrix product of a batch of two 2x3 matrices with one 3x2
+    NDArray<float> left({2, 2, 3});
+    NDArray<float> right({3, 2});
+    addScalar(left, 1.0f, left);
+    addScalar(right, 2.0f, right);
+    NDArray<float> product = matmul(left, right);
+    std::cout << "Batched matmul: " << product.dim(0) << "x" << product.dim(1) << "x" << product.dim(2)
+              << ", sum " << sum(product) << std::endl;  // 8 elements of 3 * 1 * 2
+
+    // A sparse tensor far too large to hold densely, then a small one
+    // combined with dense arrays
+    SparseNDArray<float> features({100000, 100000, 1000});
+    Vector<size_t> at;
+    at.push_back(99999);
+    at.push_back(5);
+    at.push_back(999);
+    features.setValue(at, 2.0f);
+    std::cout << "Sparse " << features.size() << "-element tensor: " << features.nonZeros() << " stored, "
+              << features.storageBytes() << " bytes, value " << features.getValue(at) << std::endl;
+    SparseNDArray<float> sparse(w);  // Every element of w is 11
+    NDArray<float> dense({4, 8});
+    add(u, sparse, dense);  // 4 + 11
+    std::cout << "Sparse-dense dot: " << dot(sparse, u) << ", product sum: " << sum(mul(sparse, u))
+              << ", sum: " << sum(dense) << std::endl;
+
+    if (!checkSimdKernels()) {
+        return 1;
+    }
+    std::cout << "SIMD kernels match the scalar path" << std::endl;
+    if (!checkMatmul()) {
+        return 1;
+    }
+    std::cout << "Blocked matmul and transpose match the naive loops" << std::endl;
+    if (!checkNpy()) {
+        return 1;
+    }
+    std::cout << ".npy files round-trip" << std::endl;
+    bool expressions = checkExpressions();
+    bool fixedRank = checkFixedRank();
+    if (!expressions || !fixedRank || !checkSparse()) {
+        return 1;
+    }
+    std::cout << "Expressions, fixed-rank and sparse arrays match element-wise loops" << std::endl;
+
     return 0;
 }
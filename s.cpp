@@ -1,155 +1,56 @@
+// The generator itself lives in one header, shared with foo/inc/foo.hpp,
+// so the command-line tool and the library cannot drift apart
+#include "foo/src/tests/foo/inc/foo.hpp"
+
 #include <iostream>
-#include <filesystem>
-#include <random>
 #include <string>
-#include <vector>
-#include <fstream>
-#include <ctime>
-#include <map>
-#include <cstdint> // For fixed-width integers
-
-// Macro for stack trace
-#define STACK_TRACE std::cerr << "Error at " << __FUNCTION__ << " (Line " << __LINE__ << ")\n"
-
-// Macro for architecture-specific code
-#if defined(__arm__) || defined(__aarch64__)
-    #define ARCHITECTURE "ARM"
-    using int32 = int32_t; // 32-bit integer type
-    using int64 = int64_t; // 64-bit integer type
-#elif defined(__i386__) || defined(__x86_64__)
-    #define ARCHITECTURE "Intel"
-    using int32 = int32_t; // 32-bit integer type
-    using int64 = int64_t; // 64-bit integer type
-#else
-    #define ARCHITECTURE "Unknown Architecture"
-    using int32 = int32_t; // Fallback to a standard 32-bit type
-    using int64 = int64_t; // Fallback to a standard 64-bit type
-#endif
-
-namespace fs = std::filesystem;
 
-class FileStructureGenerator {
-    private:
-        std::map<std::string, std::string> fileConfigs; // Maps filename to content
-        std::string rootPath;
+using FileStructureGenerator = Foo<int32>;
 
-        std::string generateRandomName(int length) {
-            static const char alphanum[] =
-                "0123456789"
-                "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-                "abcdefghijklmnopqrstuvwxyz";
-            std::random_device rd;
-            std::mt19937 gen(rd());
-            std::uniform_int_distribution<> dis(0, sizeof(alphanum) - 2); // -2 to avoid null terminator
-            std::string result;
-            result.reserve(length);
-            for (int32 i = 0; i < length; ++i) { // Use int32 here
-                result += alphanum[dis(gen)];
-            }
-            return result;
-        }
+int main(int argc, char** argv) {
+    FileStructureGenerator generator;
 
-        void createDirectory(const fs::path& path) {
-            try {
-                if (fs::create_directories(path)) {
-                    std::cout << "Created directory: " << path << std::endl;
-                }
-            } catch (const fs::filesystem_error& e) {
-                STACK_TRACE;
-                std::cerr << "Error creating directory: " << e.what() << std::endl;
-            }
-        }
+    // Print the architecture
+    std::cout << "Architecture: " << ARCHITECTURE << std::endl;
 
-        void createFile(const fs::path& path, const std::string& content = "") {
-            try {
-                std::ofstream file(path);
-                if (file.is_open()) {
-                    file << content;
-                    file.close();
-                    std::cout << "Created file: " << path << std::endl;
-                } else {
-                    STACK_TRACE;
-                    std::cerr << "Error opening file: " << path << std::endl;
-                }
-            } catch (const std::exception& e) {
-                STACK_TRACE;
-                std::cerr << "Error creating file: " << e.what() << std::endl;
-            }
+    // With a root path and a manifest on the command line, generate from the
+    // manifest; with an archive path as well, into that archive, compressed
+    // according to its extension (.gz/.tgz, .zst, .xz)
+    if (argc == 3 || argc == 4) {
+        generator.setRootPath(argv[1]);
+        if (!generator.loadManifest(argv[2])) {
+            return 1;
         }
-
-        std::string generateFileContent(const std::string& filename, bool isHeader) {
-            std::string content;
-            content += "// File: " + filename + "\n";
-            content += "// Generated: " + std::string(std::ctime(nullptr));
-
-            if (isHeader) {
-                content += "#pragma once\n\n";
-                content += "class " + fs::path(filename).stem().string() + " {\n";
-                content += "public:\n";
-                content += "    // Add your class definition here\n";
-                content += "};\n";
-            } else {
-                content += "// Implementation for " + filename + "\n";
-            }
-
-            return content;
+        if (argc == 3) {
+            return generator.generate().failed ? 1 : 0;
         }
-
-    public:
-        void setRootPath(const std::string& path) {
-            rootPath = path;
+        std::string archive = argv[3];
+        auto endsWith = [&](const std::string& suffix) {
+            return archive.size() >= suffix.size() && archive.compare(archive.size() - suffix.size(), suffix.size(), suffix) == 0;
+        };
+        Compression compression = endsWith(".gz") || endsWith(".tgz") ? Compression::Gzip
+                                  : endsWith(".zst")                  ? Compression::Zstd
+                                  : endsWith(".xz")                   ? Compression::Xz
+                                                                      : Compression::None;
+        // Entries sit under the root's name, as `tar -C <parent> -c <root>` would store them.
+        // The absolute path names roots like "." and "..", and a trailing separator
+        // leaves an empty filename, so the name is then the parent's.
+        fs::path root = fs::absolute(argv[1]).lexically_normal();
+        TarWriter writer(archive, compression, (root.has_filename() ? root : root.parent_path()).filename().string());
+        if (!writer.isOpen()) {
+            STACK_TRACE;
+            std::cerr << "Error opening archive: " << archive << std::endl;
+            return 1;
         }
-
-        void addFile(const std::string& name, const std::string& content) {
-            fileConfigs[name] = content;
+        generator.setOutput(&writer);
+        bool failed = generator.generate().failed != 0;
+        std::string log;
+        if (!writer.close(log)) {
+            std::cerr << log;
+            return 1;
         }
-
-        void generate(int numSrcFiles, int numIncFiles, int numTestFiles) {
-            // Convert rootPath to std::filesystem::path
-            fs::path rootDir = rootPath;
-
-            // Create root directories
-            fs::path srcPath = rootDir / "src";
-            fs::path incPath = rootDir / "inc";
-            fs::path testPath = rootDir / "tests";
-
-            createDirectory(srcPath);
-            createDirectory(incPath);
-            createDirectory(testPath);
-
-            // Generate source files
-            std::vector<std::string> names = {"foo", "bar", "baz", "qux", "quux"};
-            for (int32 i = 0; i < numSrcFiles; ++i) { // Use int32 here
-                if (i < names.size()) {
-                    fs::path filePath = srcPath / (names[i] + ".cpp");
-                    createFile(filePath, generateFileContent(names[i], false));
-                }
-            }
-
-            // Generate header files
-            for (int32 i = 0; i < numIncFiles; ++i) { // Use int32 here
-                if (i < names.size()) {
-                    fs::path filePath = incPath / (names[i] + ".hpp");
-                    createFile(filePath, generateFileContent(names[i], true));
-                }
-            }
-
-            // Generate test files
-            for (int32 i = 0; i < numTestFiles; ++i) { // Use int32 here
-                if (i < names.size()) {
-                    fs::path filePath = testPath / (names[i] + "_test.cpp");
-                    createFile(filePath, "// Test for " + names[i] + "\n");
-                }
-            }
-        }
-
-};
-
-int main() {
-    FileStructureGenerator generator;
-
-    // Print the architecture
-    std::cout << "Architecture: " << ARCHITECTURE << std::endl;
+        return failed ? 1 : 0;
+    }
 
     // Configure root path
     std::string rootPath;
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/objdetect.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs the eye cascade over several windows of one frame at once, one window
+// per face. A CascadeClassifier must not be used from two threads, so every
+// worker loads its own copy; the calling thread takes windows too, using the
+// classifier it passes in.
+class EyeDetectorPool {
+public:
+    EyeDetectorPool(const std::string& eyes_cascade, unsigned workers) {
+        cascades_.resize(workers);
+        for (auto& cascade : cascades_) {
+            if (!cascade.load(eyes_cascade)) {
+                ok_ = false;
+                return;
+            }
+        }
+        for (unsigned i = 0; i < workers; ++i) {
+            threads_.emplace_back([this, i] { work(cascades_[i]); });
+        }
+    }
+
+    ~EyeDetectorPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    bool ok() const { return ok_; }
+
+    // Fills eyes[i] with the eyes found in windows[i] of `gray`, in full-frame
+    // coordinates. Returns once every window is done.
+    void detect(const cv::Mat& gray, const std::vector<cv::Rect>& windows, std::vector<std::vector<cv::Rect>>& eyes,
+                cv::CascadeClassifier& local) {
+        eyes.resize(windows.size());
+        if (windows.size() <= 1 || threads_.empty()) {
+            for (size_t i = 0; i < windows.size(); ++i) {
+                detect_window(local, gray, windows[i], eyes[i]);
+            }
+            return;
+        }
+
+        Batch batch{gray, windows, eyes};
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            current_ = &batch;
+            ++generation_;
+        }
+        wake_.notify_all();
+        run(batch, local);
+
+        // Stop new workers from joining, then wait for the ones still inside
+        std::unique_lock<std::mutex> lock(mutex_);
+        current_ = nullptr;
+        done_.wait(lock, [&] { return batch.users == 0 && batch.finished == windows.size(); });
+    }
+
+    static void detect_window(cv::CascadeClassifier& cascade, const cv::Mat& gray, const cv::Rect& window,
+                              std::vector<cv::Rect>& eyes) {
+        eyes.clear();
+        if (window.empty()) {
+            return;
+        }
+        cascade.detectMultiScale(gray(window), eyes);
+        for (auto& eye : eyes) {
+            eye.x += window.x;
+            eye.y += window.y;
+        }
+    }
+
+private:
+    struct Batch {
+        const cv::Mat& gray;
+        const std::vector<cv::Rect>& windows;
+        std::vector<std::vector<cv::Rect>>& eyes;
+        std::atomic<size_t> next{0};
+        size_t finished = 0;  // Guarded by mutex_
+        unsigned users = 0;   // Workers inside run(), guarded by mutex_
+    };
+
+    // Claims windows until none are left
+    void run(Batch& batch, cv::CascadeClassifier& cascade) {
+        size_t count = batch.windows.size();
+        size_t finished = 0;
+        for (size_t i = batch.next++; i < count; i = batch.next++) {
+            detect_window(cascade, batch.gray, batch.windows[i], batch.eyes[i]);
+            ++finished;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        batch.finished += finished;
+    }
+
+    void work(cv::CascadeClassifier& cascade) {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            wake_.wait(lock, [&] { return stop_ || (current_ && generation_ != seen); });
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+            Batch* batch = current_;
+            ++batch->users;
+            lock.unlock();
+            run(*batch, cascade);
+            lock.lock();
+            --batch->users;
+            done_.notify_all();
+        }
+    }
+
+    bool ok_ = true;
+    std::vector<cv::CascadeClassifier> cascades_;
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    Batch* current_ = nullptr;
+    uint64_t generation_ = 0;
+    bool stop_ = false;
+};
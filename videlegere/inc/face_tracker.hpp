@@ -0,0 +1,215 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/objdetect.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "eye_detector_pool.hpp"
+
+// Tuning for FaceTracker
+struct TrackerOptions {
+    int redetect_interval = 10;   // Full-frame face detection every N frames, 1 disables tracking
+    double search_margin = 0.25;  // Window growth around the previous position, as a fraction of face size
+    double detect_scale = 1.0;    // Full-frame face detection runs on the frame resized by this factor
+    int min_face_size = 0;        // Smallest face searched for in full-frame pixels, 0 for the cascade's own
+    unsigned eye_workers = 2;     // Extra threads for per-face eye detection, 0 keeps it on the detect thread
+};
+
+// Runs the face cascade over the whole frame only every redetect_interval
+// frames or when a face is lost. In between, eyes are searched in a small
+// window around where they were last seen and each face rectangle follows
+// its eyes, which skips the full-frame scan that dominates detection cost.
+//
+// Each face keeps an id while it is tracked, and through a full detection
+// when the new rectangle overlaps the old one, so per-viewer state such as
+// fixations can follow it across frames.
+//
+// With an EyeDetectorPool, the eyes of different faces are searched in
+// parallel. A detect_scale below 1 runs the full-frame face scan on a
+// downscaled copy, which cuts its cost roughly by the square of the scale.
+class FaceTracker {
+public:
+    FaceTracker(cv::CascadeClassifier& face_cascade, cv::CascadeClassifier& eyes_cascade,
+                const TrackerOptions& options = TrackerOptions(), EyeDetectorPool* eye_pool = nullptr)
+        : face_cascade_(face_cascade), eyes_cascade_(eyes_cascade), options_(options), eye_pool_(eye_pool) {}
+
+    // Detects faces and eyes in a grayscale frame. Eyes are returned in
+    // full-frame coordinates, grouped by face; eye_faces[i] is the index in
+    // `faces` of the face eyes[i] belongs to.
+    void detect(const cv::Mat& gray, std::vector<cv::Rect>& faces, std::vector<uint32_t>& face_ids,
+                std::vector<cv::Rect>& eyes, std::vector<uint32_t>& eye_faces) {
+        cv::Rect bounds(0, 0, gray.cols, gray.rows);
+        bool due = options_.redetect_interval <= 1 || tracked_.empty() ||
+                   frames_since_detect_ >= static_cast<uint64_t>(options_.redetect_interval);
+        if (due || !track(gray, bounds)) {
+            detect_full(gray, bounds);
+        }
+        ++frames_since_detect_;
+
+        faces.clear();
+        face_ids.clear();
+        eyes.clear();
+        eye_faces.clear();
+        for (const auto& tracked : tracked_) {
+            eye_faces.insert(eye_faces.end(), tracked.eyes.size(), static_cast<uint32_t>(faces.size()));
+            faces.push_back(tracked.face);
+            face_ids.push_back(tracked.id);
+            eyes.insert(eyes.end(), tracked.eyes.begin(), tracked.eyes.end());
+        }
+    }
+
+    // Forget all faces, the next frame runs a full detection
+    void reset() {
+        tracked_.clear();
+    }
+
+private:
+    struct TrackedFace {
+        cv::Rect face;
+        std::vector<cv::Rect> eyes;  // Full-frame coordinates
+        uint32_t id = 0;
+    };
+
+    static cv::Rect expand(const cv::Rect& rect, int margin, const cv::Rect& bounds) {
+        return cv::Rect(rect.x - margin, rect.y - margin, rect.width + 2 * margin, rect.height + 2 * margin) & bounds;
+    }
+
+    static cv::Point centroid(const std::vector<cv::Rect>& rects) {
+        int x = 0, y = 0;
+        for (const auto& rect : rects) {
+            x += rect.x + rect.width / 2;
+            y += rect.y + rect.height / 2;
+        }
+        int n = static_cast<int>(rects.size());
+        return cv::Point(x / n, y / n);
+    }
+
+    // Eyes inside each of windows_ into found_, in full-frame coordinates
+    void detect_eyes(const cv::Mat& gray) {
+        if (eye_pool_) {
+            eye_pool_->detect(gray, windows_, found_, eyes_cascade_);
+            return;
+        }
+        found_.resize(windows_.size());
+        for (size_t i = 0; i < windows_.size(); ++i) {
+            EyeDetectorPool::detect_window(eyes_cascade_, gray, windows_[i], found_[i]);
+        }
+    }
+
+    // Faces in the whole frame, on a downscaled copy if detect_scale < 1
+    void detect_faces(const cv::Mat& gray, const cv::Rect& bounds) {
+        double scale = options_.detect_scale;
+        if (scale <= 0 || scale >= 1) {
+            scale = 1;
+        }
+        int min_size = static_cast<int>(options_.min_face_size * scale);
+        const cv::Mat* image = &gray;
+        if (scale < 1) {
+            cv::resize(gray, small_, cv::Size(), scale, scale, cv::INTER_AREA);
+            image = &small_;
+        }
+        face_cascade_.detectMultiScale(*image, faces_, 1.1, 3, 0, cv::Size(min_size, min_size));
+        if (scale < 1) {
+            for (auto& face : faces_) {
+                face = cv::Rect(cvRound(face.x / scale), cvRound(face.y / scale),
+                                cvRound(face.width / scale), cvRound(face.height / scale));
+            }
+        }
+        for (auto& face : faces_) {
+            face &= bounds;
+        }
+    }
+
+    void detect_full(const cv::Mat& gray, const cv::Rect& bounds) {
+        detect_faces(gray, bounds);
+        windows_ = faces_;
+        detect_eyes(gray);
+        previous_.swap(tracked_);
+        claimed_.assign(previous_.size(), false);
+        tracked_.resize(faces_.size());
+        for (size_t i = 0; i < faces_.size(); ++i) {
+            tracked_[i].face = faces_[i];
+            tracked_[i].eyes.swap(found_[i]);
+            tracked_[i].id = match_id(faces_[i]);
+        }
+        frames_since_detect_ = 0;
+    }
+
+    // Id of the unclaimed previous face covering most of `face`, if it
+    // covers at least half of either rectangle, else a new id
+    uint32_t match_id(const cv::Rect& face) {
+        size_t best = previous_.size();
+        int best_overlap = 0;
+        for (size_t j = 0; j < previous_.size(); ++j) {
+            int overlap = (face & previous_[j].face).area();
+            if (!claimed_[j] && overlap > best_overlap &&
+                2 * overlap >= std::min(face.area(), previous_[j].face.area())) {
+                best = j;
+                best_overlap = overlap;
+            }
+        }
+        if (best == previous_.size()) {
+            return next_id_++;
+        }
+        claimed_[best] = true;
+        return previous_[best].id;
+    }
+
+    // Follows every tracked face by its eyes; returns false if a face lost
+    // them. Faces the last full detection found without eyes have nothing to
+    // follow, so they stay where they are until the next scheduled detection
+    // rather than forcing one every frame.
+    bool track(const cv::Mat& gray, const cv::Rect& bounds) {
+        windows_.clear();
+        for (const auto& tracked : tracked_) {
+            if (tracked.eyes.empty()) {
+                continue;
+            }
+            int margin = static_cast<int>(tracked.face.width * options_.search_margin);
+            cv::Rect window = tracked.eyes.front();
+            for (const auto& eye : tracked.eyes) {
+                window |= eye;
+            }
+            windows_.push_back(expand(window, margin, bounds));
+        }
+
+        detect_eyes(gray);
+        for (const auto& found : found_) {
+            if (found.empty()) {
+                return false;
+            }
+        }
+        size_t w = 0;
+        for (auto& tracked : tracked_) {
+            if (tracked.eyes.empty()) {
+                continue;
+            }
+            std::vector<cv::Rect>& found = found_[w++];
+            cv::Point before = centroid(tracked.eyes);
+            cv::Point after = centroid(found);
+            tracked.face.x += after.x - before.x;
+            tracked.face.y += after.y - before.y;
+            tracked.face &= bounds;
+            tracked.eyes.swap(found);
+        }
+        return true;
+    }
+
+    cv::CascadeClassifier& face_cascade_;
+    cv::CascadeClassifier& eyes_cascade_;
+    TrackerOptions options_;
+    EyeDetectorPool* eye_pool_;
+    std::vector<TrackedFace> tracked_;
+    uint64_t frames_since_detect_ = 0;
+    uint32_t next_id_ = 0;
+
+    // Reused between frames to avoid per-frame allocation
+    cv::Mat small_;
+    std::vector<cv::Rect> faces_;
+    std::vector<cv::Rect> windows_;
+    std::vector<std::vector<cv::Rect>> found_;  // Eyes per window
+    std::vector<TrackedFace> previous_;         // Faces before a full detection, for matching ids
+    std::vector<bool> claimed_;                 // previous_ faces already matched
+};
@@ -0,0 +1,216 @@
+#pragma once
+
+#include "region_index.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+// Online fixation detection and reading metrics.
+//
+// Gaze points are grouped into fixations with the dispersion-threshold
+// (I-DT) algorithm: a window of points is a fixation while its spread
+// (width + height of its bounding box) stays under max_dispersion_px and it
+// lasts at least min_duration_us. The jump between two consecutive
+// fixations is counted as a saccade.
+//
+// Only the points of a window that is not yet long enough to be a fixation
+// are buffered, at most min_duration_us worth of frames. Once a fixation is
+// confirmed it grows through running bounds and sums, so memory is
+// O(regions + heatmap cells) however long the session runs.
+
+struct FixationOptions {
+    int max_dispersion_px = 40;         // Largest bounding box width + height of a fixation
+    uint64_t min_duration_us = 100000;  // Shortest fixation
+    uint64_t max_gap_us = 150000;       // A longer gap between points (e.g. a blink) ends the fixation
+    int heatmap_cell_px = 16;           // Side of one heatmap cell
+};
+
+struct Fixation {
+    uint64_t start_us;
+    uint64_t end_us;
+    cv::Point center;  // Mean gaze point
+    size_t points;
+};
+
+class GazeAggregator {
+public:
+    using FixationHandler = std::function<void(const Fixation&)>;
+
+    GazeAggregator(const TextRegionIndex& regions, const FixationOptions& options = FixationOptions())
+        : regions_(regions), options_(options), dwell_us_(regions.size(), 0), region_fixations_(regions.size(), 0) {
+        options_.heatmap_cell_px = std::max(options_.heatmap_cell_px, 1);
+    }
+
+    // Called on the adding thread for each fixation once it ends
+    void on_fixation(FixationHandler handler) { handler_ = std::move(handler); }
+
+    // Adds one gaze point of a frame of size `frame`. Points must arrive in
+    // timestamp order.
+    void add(uint64_t timestamp_us, const cv::Point& point, const cv::Size& frame) {
+        resize_heatmap(frame);
+        if (!pending_.empty() || active_) {
+            uint64_t last = active_ ? current_.end_us : pending_.back().timestamp_us;
+            if (timestamp_us < last || timestamp_us - last > options_.max_gap_us) {
+                flush();
+            }
+        }
+
+        if (active_) {
+            Bounds grown = bounds_;
+            grown.add(point);
+            if (grown.dispersion() <= options_.max_dispersion_px) {
+                bounds_ = grown;
+                current_.end_us = timestamp_us;
+                sum_x_ += point.x;
+                sum_y_ += point.y;
+                ++current_.points;
+                return;
+            }
+            finish_fixation();
+        }
+
+        pending_.push_back({timestamp_us, point});
+        Bounds window = pending_bounds();
+        // Slide the window start forward until its points fit together again
+        while (window.dispersion() > options_.max_dispersion_px) {
+            pending_.pop_front();
+            window = pending_bounds();
+        }
+        if (pending_.back().timestamp_us - pending_.front().timestamp_us >= options_.min_duration_us) {
+            start_fixation(window);
+        }
+    }
+
+    // Ends the current fixation, if any, e.g. when the viewer looks away.
+    // The next fixation is not counted as a saccade from this one.
+    void flush() {
+        if (active_) {
+            finish_fixation();
+        }
+        pending_.clear();
+        has_previous_ = false;
+    }
+
+    uint64_t fixation_count() const { return fixations_; }
+    uint64_t saccade_count() const { return saccades_; }
+    double mean_saccade_px() const { return saccades_ ? saccade_px_ / saccades_ : 0.0; }
+    uint64_t total_fixation_us() const { return fixation_us_; }
+    const TextRegionIndex& regions() const { return regions_; }
+
+    // Fixation time and count per TextRegionIndex id
+    uint64_t dwell_us(uint32_t region) const { return dwell_us_[region]; }
+    uint64_t fixation_count(uint32_t region) const { return region_fixations_[region]; }
+
+    // Fixation time in microseconds per heatmap cell, row-major
+    const std::vector<uint64_t>& heatmap() const { return heatmap_; }
+    int heatmap_cols() const { return cols_; }
+    int heatmap_rows() const { return rows_; }
+
+private:
+    struct Point {
+        uint64_t timestamp_us;
+        cv::Point point;
+    };
+
+    struct Bounds {
+        int x0 = INT32_MAX, y0 = INT32_MAX, x1 = INT32_MIN, y1 = INT32_MIN;
+
+        void add(const cv::Point& p) {
+            x0 = std::min(x0, p.x);
+            y0 = std::min(y0, p.y);
+            x1 = std::max(x1, p.x);
+            y1 = std::max(y1, p.y);
+        }
+        int dispersion() const { return (x1 - x0) + (y1 - y0); }
+    };
+
+    Bounds pending_bounds() const {
+        Bounds bounds;
+        for (const auto& p : pending_) {
+            bounds.add(p.point);
+        }
+        return bounds;
+    }
+
+    void start_fixation(const Bounds& window) {
+        active_ = true;
+        bounds_ = window;
+        current_ = {pending_.front().timestamp_us, pending_.back().timestamp_us, {}, pending_.size()};
+        sum_x_ = sum_y_ = 0;
+        for (const auto& p : pending_) {
+            sum_x_ += p.point.x;
+            sum_y_ += p.point.y;
+        }
+        pending_.clear();
+    }
+
+    void finish_fixation() {
+        active_ = false;
+        current_.center = cv::Point(static_cast<int>(sum_x_ / static_cast<int64_t>(current_.points)),
+                                    static_cast<int>(sum_y_ / static_cast<int64_t>(current_.points)));
+        uint64_t duration = current_.end_us - current_.start_us;
+
+        ++fixations_;
+        fixation_us_ += duration;
+        regions_.query(current_.center, [&](uint32_t id) {
+            dwell_us_[id] += duration;
+            ++region_fixations_[id];
+        });
+        if (cols_ > 0 && current_.center.x >= 0 && current_.center.y >= 0) {
+            int cx = std::min(current_.center.x / options_.heatmap_cell_px, cols_ - 1);
+            int cy = std::min(current_.center.y / options_.heatmap_cell_px, rows_ - 1);
+            heatmap_[static_cast<size_t>(cy) * cols_ + cx] += duration;
+        }
+
+        if (has_previous_) {
+            ++saccades_;
+            saccade_px_ += std::hypot(current_.center.x - previous_.center.x, current_.center.y - previous_.center.y);
+        }
+        previous_ = current_;
+        has_previous_ = true;
+        if (handler_) {
+            handler_(current_);
+        }
+    }
+
+    // Sizes the heatmap to cover the frame; a new frame size starts it over
+    void resize_heatmap(const cv::Size& frame) {
+        int cell = options_.heatmap_cell_px;
+        int cols = (frame.width + cell - 1) / cell;
+        int rows = (frame.height + cell - 1) / cell;
+        if (cols != cols_ || rows != rows_) {
+            cols_ = cols;
+            rows_ = rows;
+            heatmap_.assign(static_cast<size_t>(cols) * rows, 0);
+        }
+    }
+
+    const TextRegionIndex& regions_;
+    FixationOptions options_;
+    FixationHandler handler_;
+
+    // Window that is not yet a fixation, at most min_duration_us long
+    std::deque<Point> pending_;
+    // The fixation being extended
+    bool active_ = false;
+    Fixation current_{};
+    Bounds bounds_;
+    int64_t sum_x_ = 0, sum_y_ = 0;
+    // The last finished fixation, for saccade amplitudes
+    bool has_previous_ = false;
+    Fixation previous_{};
+
+    uint64_t fixations_ = 0;
+    uint64_t fixation_us_ = 0;
+    uint64_t saccades_ = 0;
+    double saccade_px_ = 0;
+    std::vector<uint64_t> dwell_us_;
+    std::vector<uint64_t> region_fixations_;
+    std::vector<uint64_t> heatmap_;
+    int cols_ = 0, rows_ = 0;
+};
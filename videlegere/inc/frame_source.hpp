@@ -0,0 +1,108 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Where the tracker gets its frames from. read() fills `frame`, reusing its
+// buffer when the size matches, and returns false when the source is done.
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+    virtual bool is_open() const = 0;
+    virtual bool read(cv::Mat& frame) = 0;
+};
+
+// Live camera by device index
+class CameraSource : public FrameSource {
+public:
+    explicit CameraSource(int device) : cap_(device) {}
+    bool is_open() const override { return cap_.isOpened(); }
+    bool read(cv::Mat& frame) override { return cap_.read(frame) && !frame.empty(); }
+
+private:
+    cv::VideoCapture cap_;
+};
+
+// Recorded video file, played back as fast as it decodes
+class VideoFileSource : public FrameSource {
+public:
+    explicit VideoFileSource(const std::string& path) : cap_(path) {}
+    bool is_open() const override { return cap_.isOpened(); }
+    bool read(cv::Mat& frame) override { return cap_.read(frame) && !frame.empty(); }
+
+private:
+    cv::VideoCapture cap_;
+};
+
+// Directory of still images, played back in file name order
+class ImageDirectorySource : public FrameSource {
+public:
+    explicit ImageDirectorySource(const std::string& dir) {
+        static const std::vector<std::string> extensions = {".png", ".jpg", ".jpeg", ".bmp", ".pgm", ".ppm"};
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+            std::string ext = entry.path().extension().string();
+            std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+            if (entry.is_regular_file() && std::find(extensions.begin(), extensions.end(), ext) != extensions.end()) {
+                files_.push_back(entry.path().string());
+            }
+        }
+        std::sort(files_.begin(), files_.end());
+    }
+
+    bool is_open() const override { return !files_.empty(); }
+
+    // Decodes into `frame` rather than assigning cv::imread's result, so
+    // images of the same size reuse its buffer instead of allocating a new one
+    bool read(cv::Mat& frame) override {
+        while (next_ < files_.size()) {
+            const std::string& path = files_[next_++];
+            if (read_bytes(path) && !cv::imdecode(bytes_, cv::IMREAD_COLOR, &frame).empty()) {
+                return true;
+            }
+            std::cerr << "Warning: Skipping unreadable image " << path << std::endl;
+        }
+        return false;
+    }
+
+private:
+    // Whole file into bytes_, reusing its capacity; false if unreadable or empty
+    bool read_bytes(const std::string& path) {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        std::streamoff size = in ? static_cast<std::streamoff>(in.tellg()) : -1;
+        if (size <= 0) {
+            return false;
+        }
+        bytes_.resize(static_cast<size_t>(size));
+        in.seekg(0);
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(bytes_.data()), size));
+    }
+
+    std::vector<std::string> files_;
+    size_t next_ = 0;
+    std::vector<unsigned char> bytes_;  // Encoded bytes of the current image
+};
+
+// Opens a source from a spec: a camera index ("0"), a directory of images,
+// or anything else as a video file
+inline std::unique_ptr<FrameSource> open_frame_source(const std::string& spec) {
+    std::unique_ptr<FrameSource> source;
+    if (!spec.empty() && std::all_of(spec.begin(), spec.end(), [](unsigned char c) { return std::isdigit(c); })) {
+        source = std::make_unique<CameraSource>(std::stoi(spec));
+    } else if (std::filesystem::is_directory(spec)) {
+        source = std::make_unique<ImageDirectorySource>(spec);
+    } else {
+        source = std::make_unique<VideoFileSource>(spec);
+    }
+    if (!source->is_open()) {
+        return nullptr;
+    }
+    return source;
+}
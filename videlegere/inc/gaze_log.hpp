@@ -0,0 +1,316 @@
+#pragma once
+
+#include "region_index.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Binary gaze event log.
+//
+// A log is a series of segments named <base>.<n>.bin, with n increasing.
+// Each segment starts with a header holding the region table, so it can be
+// decoded on its own, followed by fixed-size GazeEvent records:
+//
+//   char     magic[4]      "VLGZ"
+//   uint16_t version       GAZE_LOG_VERSION
+//   uint16_t reserved
+//   uint32_t region_count
+//   region_count x { uint32_t name_len, name, uint32_t text_len, text }
+//   GazeEvent ...
+//
+// Integers are little-endian, which is what every target we build for uses.
+
+#define GAZE_LOG_BASE "reading_log"
+#define GAZE_LOG_MAGIC "VLGZ"
+#define GAZE_LOG_VERSION 1
+#define GAZE_NO_REGION UINT32_MAX
+
+// Set on the first event written for a detected eye. An eye over several
+// regions produces one event per region, the rest without this flag.
+#define GAZE_EYE_START 0x1u
+
+struct GazeEvent {
+    uint64_t timestamp_us;  // Capture time, microseconds since the Unix epoch
+    uint64_t frame;         // Capture sequence number
+    int32_t x;              // Eye center in frame coordinates
+    int32_t y;
+    uint32_t region;        // TextRegionIndex id, or GAZE_NO_REGION
+    uint32_t flags;
+};
+static_assert(sizeof(GazeEvent) == 32, "GazeEvent is written to disk as-is");
+
+// Region table stored in every segment header
+struct GazeRegionTable {
+    std::vector<std::string> names;
+    std::vector<std::string> texts;
+
+    static GazeRegionTable from_index(const TextRegionIndex& index) {
+        GazeRegionTable table;
+        for (uint32_t id = 0; id < index.size(); ++id) {
+            table.names.push_back(index.name(id));
+            table.texts.push_back(index.text(id));
+        }
+        return table;
+    }
+};
+
+namespace gaze_log_detail {
+
+inline void write_string(std::ostream& out, const std::string& s) {
+    uint32_t len = static_cast<uint32_t>(s.size());
+    out.write(reinterpret_cast<const char*>(&len), sizeof(len));
+    out.write(s.data(), len);
+}
+
+inline bool read_string(std::istream& in, std::string& s) {
+    uint32_t len = 0;
+    if (!in.read(reinterpret_cast<char*>(&len), sizeof(len))) {
+        return false;
+    }
+    s.resize(len);
+    return static_cast<bool>(in.read(&s[0], len));
+}
+
+}  // namespace gaze_log_detail
+
+// Segments of the log at `base`, oldest first
+inline std::vector<std::filesystem::path> gaze_log_segments(const std::string& base) {
+    namespace fs = std::filesystem;
+    fs::path base_path(base);
+    fs::path dir = base_path.has_parent_path() ? base_path.parent_path() : fs::path(".");
+    std::string prefix = base_path.filename().string() + ".";
+
+    std::vector<std::pair<uint64_t, fs::path>> found;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.size() <= prefix.size() + 4 || name.compare(0, prefix.size(), prefix) != 0 ||
+            name.compare(name.size() - 4, 4, ".bin") != 0) {
+            continue;
+        }
+        std::string number = name.substr(prefix.size(), name.size() - prefix.size() - 4);
+        if (number.empty() || !std::all_of(number.begin(), number.end(), [](unsigned char c) { return std::isdigit(c); })) {
+            continue;
+        }
+        found.emplace_back(std::stoull(number), entry.path());
+    }
+    std::sort(found.begin(), found.end());
+
+    std::vector<fs::path> segments;
+    for (auto& segment : found) {
+        segments.push_back(std::move(segment.second));
+    }
+    return segments;
+}
+
+// Appends events through a pair of large buffers. The tracker fills one
+// while a background thread writes the other, so the hot loop only copies
+// 32 bytes per event and never formats or touches the file.
+class GazeLogWriter {
+public:
+    GazeLogWriter(const std::string& base, GazeRegionTable regions,
+                  size_t max_segment_bytes = 64 << 20, size_t buffer_events = 64 << 10)
+        : base_(base), regions_(std::move(regions)), max_segment_bytes_(max_segment_bytes) {
+        auto segments = gaze_log_segments(base_);
+        if (!segments.empty()) {
+            std::string name = segments.back().filename().string();
+            std::string prefix = std::filesystem::path(base_).filename().string() + ".";
+            next_segment_ = std::stoull(name.substr(prefix.size())) + 1;
+        }
+        filling_.reserve(buffer_events);
+        spare_.reserve(buffer_events);
+        writer_ = std::thread(&GazeLogWriter::run, this);
+    }
+
+    GazeLogWriter(const GazeLogWriter&) = delete;
+    GazeLogWriter& operator=(const GazeLogWriter&) = delete;
+
+    ~GazeLogWriter() {
+        flush();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        ready_.notify_one();
+        writer_.join();
+    }
+
+    void append(const GazeEvent& event) {
+        filling_.push_back(event);
+        if (filling_.size() == filling_.capacity()) {
+            hand_off();
+        }
+    }
+
+    // Hands buffered events to the writer thread without waiting for the write
+    void flush() {
+        if (!filling_.empty()) {
+            hand_off();
+        }
+    }
+
+private:
+    // Swap the full buffer with the spare one, waiting if the writer is still busy with it
+    void hand_off() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return !pending_; });
+        std::swap(filling_, spare_);
+        pending_ = true;
+        lock.unlock();
+        ready_.notify_one();
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            ready_.wait(lock, [this] { return pending_ || stopping_; });
+            if (!pending_) {
+                break;
+            }
+            lock.unlock();
+            write_events(spare_);
+            spare_.clear();
+            lock.lock();
+            pending_ = false;
+            done_.notify_one();
+        }
+        out_.close();
+    }
+
+    void write_events(const std::vector<GazeEvent>& events) {
+        if (!out_.is_open() || segment_bytes_ >= max_segment_bytes_) {
+            open_segment();
+        }
+        out_.write(reinterpret_cast<const char*>(events.data()), events.size() * sizeof(GazeEvent));
+        out_.flush();
+        segment_bytes_ += events.size() * sizeof(GazeEvent);
+        if (!out_) {
+            std::cerr << "Error: Could not write gaze log segment." << std::endl;
+        }
+    }
+
+    void open_segment() {
+        out_.close();
+        std::string path = base_ + "." + std::to_string(next_segment_++) + ".bin";
+        out_.open(path, std::ios::binary | std::ios::trunc);
+        if (!out_.is_open()) {
+            std::cerr << "Error: Could not open " << path << std::endl;
+            return;
+        }
+
+        uint16_t version = GAZE_LOG_VERSION, reserved = 0;
+        uint32_t count = static_cast<uint32_t>(regions_.names.size());
+        out_.write(GAZE_LOG_MAGIC, 4);
+        out_.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        out_.write(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
+        out_.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        for (uint32_t i = 0; i < count; ++i) {
+            gaze_log_detail::write_string(out_, regions_.names[i]);
+            gaze_log_detail::write_string(out_, regions_.texts[i]);
+        }
+        segment_bytes_ = static_cast<size_t>(out_.tellp());
+    }
+
+    std::string base_;
+    GazeRegionTable regions_;
+    size_t max_segment_bytes_;
+    uint64_t next_segment_ = 0;
+
+    std::vector<GazeEvent> filling_;  // Owned by the appending thread
+    std::vector<GazeEvent> spare_;    // Owned by the writer thread while pending_
+
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::condition_variable done_;
+    bool pending_ = false;
+    bool stopping_ = false;
+
+    std::ofstream out_;
+    size_t segment_bytes_ = 0;
+    std::thread writer_;
+};
+
+// Sequential reader for one segment
+class GazeLogReader {
+public:
+    explicit GazeLogReader(const std::string& path, size_t buffer_events = 16 << 10)
+        : in_(path, std::ios::binary), buffer_(buffer_events) {
+        if (!in_.is_open()) {
+            throw std::runtime_error("Could not open gaze log " + path);
+        }
+        char magic[4];
+        uint16_t version = 0, reserved = 0;
+        uint32_t count = 0;
+        in_.read(magic, 4);
+        in_.read(reinterpret_cast<char*>(&version), sizeof(version));
+        in_.read(reinterpret_cast<char*>(&reserved), sizeof(reserved));
+        in_.read(reinterpret_cast<char*>(&count), sizeof(count));
+        if (!in_ || std::memcmp(magic, GAZE_LOG_MAGIC, 4) != 0 || version != GAZE_LOG_VERSION) {
+            throw std::runtime_error("Not a gaze log: " + path);
+        }
+        regions_.names.resize(count);
+        regions_.texts.resize(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            if (!gaze_log_detail::read_string(in_, regions_.names[i]) ||
+                !gaze_log_detail::read_string(in_, regions_.texts[i])) {
+                throw std::runtime_error("Truncated gaze log header: " + path);
+            }
+        }
+        data_start_ = in_.tellg();
+    }
+
+    const GazeRegionTable& regions() const { return regions_; }
+
+    // Positions the reader at the given event, e.g. to resume following a
+    // segment that is still being written
+    void seek(uint64_t event_index) {
+        in_.clear();
+        in_.seekg(data_start_ + static_cast<std::streamoff>(event_index * sizeof(GazeEvent)));
+        pos_ = 0;
+        count_ = 0;
+    }
+
+    // Returns false at the end of the segment. A torn trailing record from an
+    // interrupted write is ignored.
+    bool next(GazeEvent& event) {
+        if (pos_ == count_) {
+            in_.read(reinterpret_cast<char*>(buffer_.data()), buffer_.size() * sizeof(GazeEvent));
+            count_ = static_cast<size_t>(in_.gcount()) / sizeof(GazeEvent);
+            pos_ = 0;
+            if (count_ == 0) {
+                return false;
+            }
+        }
+        event = buffer_[pos_++];
+        return true;
+    }
+
+private:
+    std::ifstream in_;
+    GazeRegionTable regions_;
+    std::streamoff data_start_ = 0;
+    std::vector<GazeEvent> buffer_;
+    size_t pos_ = 0;
+    size_t count_ = 0;
+};
+
+// Writes events in the original reading_log.txt format
+inline void write_gaze_text(std::ostream& out, const GazeEvent& event, const GazeRegionTable& regions) {
+    if (event.flags & GAZE_EYE_START) {
+        out << "Eye detected at: " << event.x << ", " << event.y << "\n";
+    }
+    if (event.region != GAZE_NO_REGION && event.region < regions.texts.size()) {
+        out << "Looking at text: " << regions.texts[event.region] << "\n";
+    }
+}
@@ -0,0 +1,327 @@
+#pragma once
+
+#include "gaze_log.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Query index over gaze events.
+//
+// Consecutive events on the same region are merged into read intervals,
+// which are far fewer than events, and only intervals are kept:
+//   - per region, intervals sorted by time with prefix sums of their
+//     durations, so dwell time over any window is two binary searches;
+//   - one time-sorted list of all intervals for range scans;
+//   - an inverted index from lowercase word to the regions containing it.
+// Memory is O(intervals + regions + vocabulary), independent of event count.
+//
+// Region ids here are global: the same (name, text) pair seen in different
+// log segments maps to one id.
+
+struct ReadInterval {
+    uint64_t start_us;
+    uint64_t end_us;  // Timestamp of the last event in the interval
+    uint32_t region;
+};
+
+class GazeLogIndex {
+public:
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    // Events on one region further apart than `gap_us` start a new interval
+    explicit GazeLogIndex(uint64_t gap_us = 500000) : gap_us_(gap_us) {}
+
+    // Global id for a region, adding it to the inverted index if new
+    uint32_t intern_region(const std::string& name, const std::string& text) {
+        std::string key = name + '\0' + text;
+        auto it = region_ids_.find(key);
+        if (it != region_ids_.end()) {
+            return it->second;
+        }
+        uint32_t id = static_cast<uint32_t>(regions_.size());
+        region_ids_.emplace(std::move(key), id);
+        regions_.push_back({name, text, {}, {}});
+
+        std::vector<std::string> words = tokenize(text);
+        std::sort(words.begin(), words.end());
+        words.erase(std::unique(words.begin(), words.end()), words.end());
+        for (const auto& word : words) {
+            postings_[word].push_back(id);  // Ids only grow, so postings stay sorted
+        }
+        return id;
+    }
+
+    // Adds one event. Events are expected in timestamp order; one older than
+    // the region's latest interval (e.g. after a clock step) is skipped so
+    // per-region intervals stay sorted.
+    void add(const GazeEvent& event, uint32_t region) {
+        if (region >= regions_.size()) {
+            return;
+        }
+        RegionData& data = regions_[region];
+        uint64_t t = event.timestamp_us;
+        if (!data.intervals.empty() && t < data.intervals.back().start_us) {
+            return;
+        }
+        ++events_;
+        if (!data.intervals.empty() && t <= data.intervals.back().end_us + gap_us_) {
+            Interval& open = data.intervals.back();
+            open.end_us = std::max(open.end_us, t);
+            max_duration_ = std::max(max_duration_, open.end_us - open.start_us);
+            return;
+        }
+
+        uint64_t before = data.intervals.empty() ? 0 : data.before.back() + duration(data.intervals.back());
+        data.intervals.push_back({t, t});
+        data.before.push_back(before);
+
+        TimeEntry entry{t, region, static_cast<uint32_t>(data.intervals.size() - 1)};
+        auto pos = std::upper_bound(timeline_.begin(), timeline_.end(), entry,
+                                    [](const TimeEntry& a, const TimeEntry& b) { return a.start_us < b.start_us; });
+        timeline_.insert(pos, entry);
+    }
+
+    size_t region_count() const { return regions_.size(); }
+    size_t event_count() const { return events_; }
+    size_t interval_count() const { return timeline_.size(); }
+    const std::string& name(uint32_t region) const { return regions_[region].name; }
+    const std::string& text(uint32_t region) const { return regions_[region].text; }
+
+    uint32_t find_region(const std::string& name) const {
+        for (uint32_t id = 0; id < regions_.size(); ++id) {
+            if (regions_[id].name == name) {
+                return id;
+            }
+        }
+        return npos;
+    }
+
+    // Regions whose text contains `phrase` (case-insensitive), via the
+    // inverted index and then an exact check on the few candidates
+    std::vector<uint32_t> regions_containing(const std::string& phrase) const {
+        std::vector<std::string> words = tokenize(phrase);
+        if (words.empty()) {
+            return {};
+        }
+        std::vector<uint32_t> candidates;
+        for (size_t i = 0; i < words.size(); ++i) {
+            auto it = postings_.find(words[i]);
+            if (it == postings_.end()) {
+                return {};
+            }
+            if (i == 0) {
+                candidates = it->second;
+                continue;
+            }
+            std::vector<uint32_t> both;
+            std::set_intersection(candidates.begin(), candidates.end(), it->second.begin(), it->second.end(),
+                                  std::back_inserter(both));
+            candidates.swap(both);
+        }
+
+        std::string needle = normalize(phrase);
+        std::vector<uint32_t> matches;
+        for (uint32_t id : candidates) {
+            if (normalize(regions_[id].text).find(needle) != std::string::npos) {
+                matches.push_back(id);
+            }
+        }
+        return matches;
+    }
+
+    // Time a region was read within [t1, t2], in microseconds
+    uint64_t dwell_us(uint32_t region, uint64_t t1, uint64_t t2) const {
+        if (region >= regions_.size() || t2 < t1) {
+            return 0;
+        }
+        const RegionData& data = regions_[region];
+        const auto& iv = data.intervals;
+        // Intervals of one region don't overlap, so both starts and ends are sorted
+        size_t first = std::lower_bound(iv.begin(), iv.end(), t1,
+                                        [](const Interval& a, uint64_t t) { return a.end_us < t; }) - iv.begin();
+        size_t last = std::upper_bound(iv.begin(), iv.end(), t2,
+                                       [](uint64_t t, const Interval& a) { return t < a.start_us; }) - iv.begin();
+        if (first >= last) {
+            return 0;
+        }
+        --last;
+        uint64_t total = data.before[last] - data.before[first] + duration(iv[last]);
+        if (iv[first].start_us < t1) {
+            total -= t1 - iv[first].start_us;
+        }
+        if (iv[last].end_us > t2) {
+            total -= iv[last].end_us - t2;
+        }
+        return total;
+    }
+
+    // Calls visit(ReadInterval) for every interval overlapping [t1, t2], by start time
+    template <typename Visitor>
+    void scan(uint64_t t1, uint64_t t2, Visitor&& visit) const {
+        uint64_t from = t1 > max_duration_ ? t1 - max_duration_ : 0;
+        auto it = std::lower_bound(timeline_.begin(), timeline_.end(), from,
+                                   [](const TimeEntry& e, uint64_t t) { return e.start_us < t; });
+        for (; it != timeline_.end() && it->start_us <= t2; ++it) {
+            const Interval& interval = regions_[it->region].intervals[it->index];
+            if (interval.end_us >= t1) {
+                visit(ReadInterval{interval.start_us, interval.end_us, it->region});
+            }
+        }
+    }
+
+    // All intervals of one region overlapping [t1, t2]
+    std::vector<ReadInterval> intervals(uint32_t region, uint64_t t1 = 0, uint64_t t2 = UINT64_MAX) const {
+        std::vector<ReadInterval> result;
+        if (region >= regions_.size()) {
+            return result;
+        }
+        const auto& iv = regions_[region].intervals;
+        auto it = std::lower_bound(iv.begin(), iv.end(), t1,
+                                   [](const Interval& a, uint64_t t) { return a.end_us < t; });
+        for (; it != iv.end() && it->start_us <= t2; ++it) {
+            result.push_back({it->start_us, it->end_us, region});
+        }
+        return result;
+    }
+
+    static std::vector<std::string> tokenize(const std::string& text) {
+        std::vector<std::string> words;
+        std::string word;
+        for (unsigned char c : text) {
+            if (std::isalnum(c)) {
+                word += static_cast<char>(std::tolower(c));
+            } else if (!word.empty()) {
+                words.push_back(std::move(word));
+                word.clear();
+            }
+        }
+        if (!word.empty()) {
+            words.push_back(std::move(word));
+        }
+        return words;
+    }
+
+private:
+    struct Interval {
+        uint64_t start_us;
+        uint64_t end_us;
+    };
+
+    struct RegionData {
+        std::string name;
+        std::string text;
+        std::vector<Interval> intervals;
+        std::vector<uint64_t> before;  // Sum of durations of all earlier intervals
+    };
+
+    struct TimeEntry {
+        uint64_t start_us;
+        uint32_t region;
+        uint32_t index;  // Into the region's intervals
+    };
+
+    static uint64_t duration(const Interval& interval) {
+        return interval.end_us - interval.start_us;
+    }
+
+    // Lowercase words joined by single spaces, for phrase matching
+    static std::string normalize(const std::string& text) {
+        std::string result;
+        for (const auto& word : tokenize(text)) {
+            if (!result.empty()) {
+                result += ' ';
+            }
+            result += word;
+        }
+        return result;
+    }
+
+    uint64_t gap_us_;
+    uint64_t max_duration_ = 0;
+    size_t events_ = 0;
+    std::vector<RegionData> regions_;
+    std::unordered_map<std::string, uint32_t> region_ids_;
+    std::unordered_map<std::string, std::vector<uint32_t>> postings_;
+    std::vector<TimeEntry> timeline_;
+};
+
+// Keeps a GazeLogIndex up to date with the segments of a log on disk.
+// Each refresh() reads only events appended since the previous call.
+class GazeLogFollower {
+public:
+    explicit GazeLogFollower(const std::string& base, uint64_t gap_us = 500000) : base_(base), index_(gap_us) {}
+
+    // Returns the number of new events indexed. Only the newest segment is
+    // still growing, so older ones are read to the end once and then skipped.
+    size_t refresh() {
+        size_t added = 0;
+        auto paths = gaze_log_segments(base_);
+        for (size_t i = 0; i < paths.size(); ++i) {
+            std::string key = paths[i].string();
+            Segment& segment = segments_[key];
+            if (segment.complete) {
+                continue;
+            }
+            added += follow(key, segment);
+            segment.complete = segment.mapped && i + 1 < paths.size();
+        }
+        return added;
+    }
+
+    const GazeLogIndex& index() const { return index_; }
+
+private:
+    struct Segment {
+        bool mapped = false;
+        bool complete = false;          // Superseded by a newer segment and fully read
+        std::vector<uint32_t> regions;  // Segment region id -> global id
+        uint64_t events = 0;            // Complete events already indexed
+    };
+
+    size_t follow(const std::string& path, Segment& segment) {
+        try {
+            GazeLogReader reader(path);
+            if (!segment.mapped) {
+                const GazeRegionTable& table = reader.regions();
+                for (size_t i = 0; i < table.names.size(); ++i) {
+                    segment.regions.push_back(index_.intern_region(table.names[i], table.texts[i]));
+                }
+                segment.mapped = true;
+            }
+            reader.seek(segment.events);
+            size_t added = 0;
+            GazeEvent event;
+            while (reader.next(event)) {
+                ++segment.events;
+                ++added;
+                if (event.region < segment.regions.size()) {
+                    index_.add(event, segment.regions[event.region]);
+                }
+            }
+            return added;
+        } catch (std::exception& e) {
+            // A segment whose header is still being written is retried next time
+            return 0;
+        }
+    }
+
+    std::string base_;
+    GazeLogIndex index_;
+    std::unordered_map<std::string, Segment> segments_;
+};
+
+inline std::string format_timestamp(uint64_t timestamp_us) {
+    std::time_t seconds = static_cast<std::time_t>(timestamp_us / 1000000);
+    std::tm local{};
+    localtime_r(&seconds, &local);
+    std::ostringstream out;
+    out << std::put_time(&local, "%Y-%m-%d %H:%M:%S");
+    return out.str();
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Building blocks for the staged capture -> detect -> sink tracker.
+// Frames are preallocated in a FramePool and only pointers move between
+// stages, so cv::Mat buffers are reused instead of reallocated per frame.
+
+// A captured frame plus everything the detection stage found in it
+struct Frame {
+    cv::Mat image;                   // BGR capture, drawn on by the sink
+    cv::Mat gray;                    // Grayscale copy used for detection
+    uint64_t number = 0;             // Capture sequence number
+    uint64_t timestamp_us = 0;       // Wall-clock capture time, microseconds since the Unix epoch
+    std::chrono::steady_clock::time_point captured;
+    std::vector<cv::Rect> faces;
+    std::vector<uint32_t> face_ids;  // Tracking id of each face, stable across frames
+    std::vector<cv::Rect> eyes;      // In full-frame coordinates
+    std::vector<uint32_t> eye_faces; // Index in faces of each eye's face
+};
+
+// Bounded single-producer/single-consumer ring of trivially copyable items.
+// When full, the producer may evict the oldest item instead of blocking,
+// which keeps end-to-end latency bounded when the consumer falls behind.
+// Eviction is the only time the producer touches head_, so the consumer
+// claims items with a CAS and retries if the producer got there first.
+template <typename T, size_t Capacity>
+class SPSCQueue {
+    static_assert(std::is_trivially_copyable<T>::value, "SPSCQueue stores items by value in atomics");
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // Producer: returns false if the queue is full
+    bool try_push(T item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        slots_[tail & (Capacity - 1)].store(item, std::memory_order_relaxed);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer: pushes unconditionally, handing back the evicted item if
+    // the queue was full. Returns true if `evicted` was filled in.
+    bool push_evicting(T item, T& evicted) {
+        bool dropped = false;
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_acquire);
+        while (tail - head == Capacity) {
+            T oldest = slots_[head & (Capacity - 1)].load(std::memory_order_relaxed);
+            if (head_.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel)) {
+                evicted = oldest;
+                dropped = true;
+                break;
+            }
+            // The consumer popped it meanwhile, head now holds the new value
+        }
+        slots_[tail & (Capacity - 1)].store(item, std::memory_order_relaxed);
+        tail_.store(tail + 1, std::memory_order_release);
+        return dropped;
+    }
+
+    // Consumer: returns false if the queue is empty
+    bool try_pop(T& item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            if (head == tail_.load(std::memory_order_acquire)) {
+                return false;
+            }
+            T candidate = slots_[head & (Capacity - 1)].load(std::memory_order_relaxed);
+            if (head_.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel)) {
+                item = candidate;
+                return true;
+            }
+        }
+    }
+
+private:
+    std::atomic<T> slots_[Capacity];
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
+// Fixed set of Frames shared by all stages. Frames come back from several
+// threads (evictions in any stage, the sink when done), so the free list is
+// a bounded multi-producer/multi-consumer ring with per-slot sequence numbers.
+template <size_t Capacity>
+class FramePool {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // Starts full: every cell holds a frame, as if all had been released
+    FramePool() : frames_(Capacity) {
+        for (size_t i = 0; i < Capacity; ++i) {
+            cells_[i].frame = &frames_[i];
+            cells_[i].sequence.store(i + 1, std::memory_order_relaxed);
+        }
+        enqueue_.store(Capacity, std::memory_order_relaxed);
+    }
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    // Returns nullptr if every frame is in flight
+    Frame* acquire() {
+        size_t pos = dequeue_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & (Capacity - 1)];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    Frame* frame = cell.frame;
+                    cell.sequence.store(pos + Capacity, std::memory_order_release);
+                    return frame;
+                }
+            } else if (diff < 0) {
+                return nullptr;
+            } else {
+                pos = dequeue_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void release(Frame* frame) {
+        size_t pos = enqueue_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & (Capacity - 1)];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.frame = frame;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return;
+                }
+            } else {
+                // The pool never holds more than Capacity frames, so diff < 0 cannot happen
+                pos = enqueue_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        Frame* frame;
+    };
+
+    std::vector<Frame> frames_;
+    Cell cells_[Capacity];
+    alignas(64) std::atomic<size_t> enqueue_{0};
+    alignas(64) std::atomic<size_t> dequeue_{0};
+};
+
+// Back off briefly while a stage has nothing to do
+inline void stage_idle() {
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Structure to represent text regions with coordinates
+struct TextRegion {
+    std::string text;
+    cv::Rect bounding_box;  // x, y, width, height
+};
+
+// Uniform grid over text regions for gaze-to-region lookup.
+//
+// Region boxes are kept in one flat array (hot, touched per query) and their
+// names and text in parallel arrays (cold, touched only on a hit). Each grid
+// cell lists the regions overlapping it in CSR form: cell_start_[c] ..
+// cell_start_[c + 1] index into cell_items_. Cells are sized from the average
+// region, so a point query inspects O(1) boxes regardless of page length.
+//
+// Region ids are indices in map iteration order and are stable for the
+// lifetime of the index.
+class TextRegionIndex {
+public:
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    explicit TextRegionIndex(const std::map<std::string, TextRegion>& regions) {
+        boxes_.reserve(regions.size());
+        names_.reserve(regions.size());
+        texts_.reserve(regions.size());
+        for (const auto& region : regions) {
+            const cv::Rect& box = region.second.bounding_box;
+            boxes_.push_back({box.x, box.y, box.x + box.width, box.y + box.height});
+            names_.push_back(region.first);
+            texts_.push_back(region.second.text);
+        }
+        build_grid();
+    }
+
+    size_t size() const { return boxes_.size(); }
+    const std::string& name(uint32_t id) const { return names_[id]; }
+    const std::string& text(uint32_t id) const { return texts_[id]; }
+
+    cv::Rect box(uint32_t id) const {
+        const Box& b = boxes_[id];
+        return cv::Rect(b.x0, b.y0, b.x1 - b.x0, b.y1 - b.y0);
+    }
+
+    // Calls visit(id) for every region containing `point`, in id order
+    template <typename Visitor>
+    void query(const cv::Point& point, Visitor&& visit) const {
+        if (boxes_.empty() || point.x < origin_x_ || point.y < origin_y_) {
+            return;
+        }
+        size_t cx = static_cast<size_t>((point.x - origin_x_) / cell_w_);
+        size_t cy = static_cast<size_t>((point.y - origin_y_) / cell_h_);
+        if (cx >= cols_ || cy >= rows_) {
+            return;
+        }
+        size_t cell = cy * cols_ + cx;
+        for (uint32_t i = cell_start_[cell]; i < cell_start_[cell + 1]; ++i) {
+            uint32_t id = cell_items_[i];
+            const Box& b = boxes_[id];
+            // Same half-open test as cv::Rect::contains
+            if (point.x >= b.x0 && point.x < b.x1 && point.y >= b.y0 && point.y < b.y1) {
+                visit(id);
+            }
+        }
+    }
+
+    // First region containing `point`, or npos
+    uint32_t find(const cv::Point& point) const {
+        uint32_t found = npos;
+        query(point, [&](uint32_t id) {
+            if (found == npos) {
+                found = id;
+            }
+        });
+        return found;
+    }
+
+private:
+    struct Box {
+        int x0, y0, x1, y1;  // Half-open [x0, x1) x [y0, y1)
+    };
+
+    void build_grid() {
+        if (boxes_.empty()) {
+            cell_start_.assign(1, 0);
+            return;
+        }
+
+        int x1 = boxes_[0].x1, y1 = boxes_[0].y1;
+        origin_x_ = boxes_[0].x0;
+        origin_y_ = boxes_[0].y0;
+        double total_w = 0, total_h = 0;
+        for (const auto& b : boxes_) {
+            origin_x_ = std::min(origin_x_, b.x0);
+            origin_y_ = std::min(origin_y_, b.y0);
+            x1 = std::max(x1, b.x1);
+            y1 = std::max(y1, b.y1);
+            total_w += b.x1 - b.x0;
+            total_h += b.y1 - b.y0;
+        }
+
+        // Cells about the size of an average region, capped at 4 per region
+        double n = static_cast<double>(boxes_.size());
+        double span_w = std::max(1, x1 - origin_x_);
+        double span_h = std::max(1, y1 - origin_y_);
+        cell_w_ = std::max(1, static_cast<int>(total_w / n));
+        cell_h_ = std::max(1, static_cast<int>(total_h / n));
+        while ((span_w / cell_w_) * (span_h / cell_h_) > 4 * n) {
+            cell_w_ *= 2;
+            cell_h_ *= 2;
+        }
+        cols_ = static_cast<size_t>(std::ceil(span_w / cell_w_));
+        rows_ = static_cast<size_t>(std::ceil(span_h / cell_h_));
+
+        // Two passes: count regions per cell, then scatter ids in order
+        cell_start_.assign(cols_ * rows_ + 1, 0);
+        for_each_cell([&](size_t cell, uint32_t) { ++cell_start_[cell + 1]; });
+        for (size_t c = 0; c < cols_ * rows_; ++c) {
+            cell_start_[c + 1] += cell_start_[c];
+        }
+        cell_items_.resize(cell_start_.back());
+        std::vector<uint32_t> fill(cell_start_.begin(), cell_start_.end() - 1);
+        for_each_cell([&](size_t cell, uint32_t id) { cell_items_[fill[cell]++] = id; });
+    }
+
+    // Calls f(cell, id) for every cell each non-empty region overlaps
+    template <typename F>
+    void for_each_cell(F&& f) const {
+        for (uint32_t id = 0; id < boxes_.size(); ++id) {
+            const Box& b = boxes_[id];
+            if (b.x1 <= b.x0 || b.y1 <= b.y0) {
+                continue;
+            }
+            size_t cx0 = (b.x0 - origin_x_) / cell_w_, cx1 = (b.x1 - 1 - origin_x_) / cell_w_;
+            size_t cy0 = (b.y0 - origin_y_) / cell_h_, cy1 = (b.y1 - 1 - origin_y_) / cell_h_;
+            for (size_t cy = cy0; cy <= cy1; ++cy) {
+                for (size_t cx = cx0; cx <= cx1; ++cx) {
+                    f(cy * cols_ + cx, id);
+                }
+            }
+        }
+    }
+
+    std::vector<Box> boxes_;
+    std::vector<std::string> names_;
+    std::vector<std::string> texts_;
+
+    int origin_x_ = 0, origin_y_ = 0;
+    int cell_w_ = 1, cell_h_ = 1;
+    size_t cols_ = 0, rows_ = 0;
+    std::vector<uint32_t> cell_start_;
+    std::vector<uint32_t> cell_items_;
+};
@@ -0,0 +1,370 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/objdetect.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "face_tracker.hpp"
+#include "fixations.hpp"
+#include "frame_source.hpp"
+#include "gaze_log.hpp"
+#include "pipeline.hpp"
+#include "region_index.hpp"
+
+// Number of pooled frames and depth of the queues between stages. Short
+// queues keep latency low; the pool must cover every frame that can be in
+// flight at once (two queues, one frame per stage).
+#define FRAME_POOL_SIZE 8
+#define STAGE_QUEUE_SIZE 2
+
+using TrackerFramePool = FramePool<FRAME_POOL_SIZE>;
+using FrameQueue = SPSCQueue<Frame*, STAGE_QUEUE_SIZE>;
+
+struct TrackerConfig {
+    std::string source = "0";              // Camera index, video file or image directory
+    bool headless = false;                 // No drawing, imshow or waitKey
+    bool drop_frames = true;               // Drop the oldest queued frame when a stage falls behind
+    std::string log_base = GAZE_LOG_BASE;  // Empty disables the gaze log
+    std::string face_cascade = "haarcascade_frontalface_default.xml";
+    std::string eyes_cascade = "haarcascade_eye.xml";
+    TrackerOptions tracker;
+    // Receives one JSON summary of eyes and regions per displayed frame
+    std::function<void(const std::string&)> publish_gaze;
+    FixationOptions fixations;
+    // Called on the sink thread as each fixation ends, with the running
+    // metrics of the face (viewer) it belongs to
+    std::function<void(const Fixation&, const GazeAggregator&)> on_fixation;
+};
+
+// Per-stage counters, each written only by its own stage
+struct StageStats {
+    uint64_t frames = 0;   // Frames processed
+    uint64_t dropped = 0;  // Queued frames evicted by this stage's pushes
+    double busy_ms = 0;    // Time spent on work, excluding waits
+};
+
+struct TrackerStats {
+    StageStats capture;
+    StageStats detect;
+    StageStats sink;
+    double elapsed_s = 0;
+    uint64_t fixations = 0;
+    uint64_t saccades = 0;
+    std::map<std::string, uint64_t> dwell_us;  // Fixation time by region name
+    // Fixation time in microseconds per heatmap cell over every face,
+    // row-major, with cells FixationOptions::heatmap_cell_px on a side
+    std::vector<uint64_t> heatmap;
+    int heatmap_cols = 0;
+    int heatmap_rows = 0;
+};
+
+// Shutdown flags shared by the tracker stages
+struct PipelineState {
+    std::atomic<bool> stop{false};          // Set by the sink on ESC
+    std::atomic<bool> capture_done{false};  // No more frames will be queued for detection
+    std::atomic<bool> detect_done{false};   // No more frames will be queued for the sink
+    bool drop_frames = true;
+};
+
+// Appends `s` as a JSON string literal
+inline void append_json_string(std::string& out, const std::string& s) {
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c < 0x20) {
+            out += "\\u00";
+            out += hex[c >> 4];
+            out += hex[c & 0xf];
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    out += '"';
+}
+
+inline double ms_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Push to the next stage. When dropping, a full queue recycles its oldest
+// frame; otherwise wait for room so replays process every frame.
+inline void forward_frame(Frame* frame, FrameQueue& out, TrackerFramePool& pool, PipelineState& state, StageStats& stats) {
+    if (state.drop_frames) {
+        Frame* evicted = nullptr;
+        if (out.push_evicting(frame, evicted)) {
+            pool.release(evicted);
+            ++stats.dropped;
+        }
+        return;
+    }
+    while (!out.try_push(frame)) {
+        if (state.stop) {
+            pool.release(frame);
+            return;
+        }
+        stage_idle();
+    }
+}
+
+// Pop from the previous stage; returns false once it is finished and drained
+inline bool next_frame(FrameQueue& in, const std::atomic<bool>& upstream_done, const PipelineState& state, Frame*& frame) {
+    while (!state.stop) {
+        if (in.try_pop(frame)) {
+            return true;
+        }
+        if (upstream_done) {
+            return in.try_pop(frame);
+        }
+        stage_idle();
+    }
+    return false;
+}
+
+// Capture stage: reads frames from the source into pooled buffers
+inline void capture_frames(FrameSource& source, TrackerFramePool& pool, FrameQueue& out, PipelineState& state, StageStats& stats) {
+    uint64_t number = 0;
+    while (!state.stop) {
+        Frame* frame = pool.acquire();
+        if (!frame) {
+            stage_idle();
+            continue;
+        }
+        auto start = std::chrono::steady_clock::now();
+        if (!source.read(frame->image)) {
+            pool.release(frame);
+            break;
+        }
+        frame->number = number++;
+        frame->captured = std::chrono::steady_clock::now();
+        frame->timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        stats.busy_ms += ms_since(start);
+        ++stats.frames;
+        forward_frame(frame, out, pool, state, stats);
+    }
+    state.capture_done = true;
+}
+
+// Detection stage: grayscale conversion, face and eye detection
+inline void detect_frames(FaceTracker& tracker, TrackerFramePool& pool, FrameQueue& in, FrameQueue& out, PipelineState& state, StageStats& stats) {
+    Frame* frame = nullptr;
+    while (next_frame(in, state.capture_done, state, frame)) {
+        auto start = std::chrono::steady_clock::now();
+        cv::cvtColor(frame->image, frame->gray, cv::COLOR_BGR2GRAY);
+        tracker.detect(frame->gray, frame->faces, frame->face_ids, frame->eyes, frame->eye_faces);
+        stats.busy_ms += ms_since(start);
+        ++stats.frames;
+        forward_frame(frame, out, pool, state, stats);
+    }
+    state.detect_done = true;
+}
+
+// Function to detect eyes and track gaze location. Capture and detection run
+// on their own threads; drawing, logging and display stay on the calling
+// thread because HighGUI windows must be driven from one thread.
+// Returns false if the cascades or the frame source could not be opened.
+inline bool track_eyes(const std::map<std::string, TextRegion>& text_regions, const TrackerConfig& config = TrackerConfig(),
+                       TrackerStats* stats_out = nullptr) {
+    cv::CascadeClassifier face_cascade;
+    cv::CascadeClassifier eyes_cascade;
+
+    // Load the pre-trained Haar Cascade classifiers for face and eyes
+    if (!face_cascade.load(config.face_cascade) || !eyes_cascade.load(config.eyes_cascade)) {
+        std::cerr << "Error: Could not load Haar cascades." << std::endl;
+        return false;
+    }
+
+    std::unique_ptr<FrameSource> source = open_frame_source(config.source);
+    if (!source) {
+        std::cerr << "Error: Could not open frame source " << config.source << std::endl;
+        return false;
+    }
+
+    auto pool = std::make_unique<TrackerFramePool>();
+    FrameQueue captured, detected;
+    PipelineState state;
+    state.drop_frames = config.drop_frames;
+    TrackerStats stats;
+    // Workers for per-face eye detection, each with its own cascade
+    std::unique_ptr<EyeDetectorPool> eye_pool;
+    if (config.tracker.eye_workers > 0) {
+        eye_pool = std::make_unique<EyeDetectorPool>(config.eyes_cascade, config.tracker.eye_workers);
+        if (!eye_pool->ok()) {
+            std::cerr << "Error: Could not load Haar cascades." << std::endl;
+            return false;
+        }
+    }
+    FaceTracker tracker(face_cascade, eyes_cascade, config.tracker, eye_pool.get());
+    TextRegionIndex region_index(text_regions);
+    std::unique_ptr<GazeLogWriter> gaze_log;
+    if (!config.log_base.empty()) {
+        gaze_log = std::make_unique<GazeLogWriter>(config.log_base, GazeRegionTable::from_index(region_index));
+    }
+    // One aggregator per tracked face, so several viewers are never averaged
+    // into one gaze point. A face that leaves the frame is flushed and its
+    // counts and heatmap folded into the stats. Cells cover the same pixels
+    // whatever the frame size, so heatmaps merge by cell coordinates.
+    std::map<uint32_t, std::unique_ptr<GazeAggregator>> aggregators;
+    std::vector<uint64_t> dwell_us(region_index.size(), 0);
+    auto retire = [&](GazeAggregator& aggregator) {
+        aggregator.flush();
+        stats.fixations += aggregator.fixation_count();
+        stats.saccades += aggregator.saccade_count();
+        for (uint32_t id = 0; id < region_index.size(); ++id) {
+            dwell_us[id] += aggregator.dwell_us(id);
+        }
+        int cols = std::max(stats.heatmap_cols, aggregator.heatmap_cols());
+        int rows = std::max(stats.heatmap_rows, aggregator.heatmap_rows());
+        if (cols != stats.heatmap_cols || rows != stats.heatmap_rows) {
+            std::vector<uint64_t> grown(static_cast<size_t>(cols) * rows, 0);
+            for (int y = 0; y < stats.heatmap_rows; ++y) {
+                std::copy_n(stats.heatmap.begin() + static_cast<size_t>(y) * stats.heatmap_cols, stats.heatmap_cols,
+                            grown.begin() + static_cast<size_t>(y) * cols);
+            }
+            stats.heatmap.swap(grown);
+            stats.heatmap_cols = cols;
+            stats.heatmap_rows = rows;
+        }
+        const std::vector<uint64_t>& cells = aggregator.heatmap();
+        for (int y = 0; y < aggregator.heatmap_rows(); ++y) {
+            for (int x = 0; x < aggregator.heatmap_cols(); ++x) {
+                stats.heatmap[static_cast<size_t>(y) * cols + x] += cells[static_cast<size_t>(y) * aggregator.heatmap_cols() + x];
+            }
+        }
+    };
+    std::vector<cv::Point> face_sums;
+    std::vector<int> face_eyes;
+
+    auto started = std::chrono::steady_clock::now();
+    std::thread capture_thread(capture_frames, std::ref(*source), std::ref(*pool), std::ref(captured),
+                               std::ref(state), std::ref(stats.capture));
+    std::thread detect_thread(detect_frames, std::ref(tracker), std::ref(*pool), std::ref(captured),
+                              std::ref(detected), std::ref(state), std::ref(stats.detect));
+
+    // Sink stage: draw, log, aggregate, publish and display
+    std::string gaze_json;
+    Frame* frame = nullptr;
+    while (next_frame(detected, state.detect_done, state, frame)) {
+        auto start = std::chrono::steady_clock::now();
+        bool publishing = static_cast<bool>(config.publish_gaze);
+        if (publishing) {
+            gaze_json = "{\"frame\":" + std::to_string(frame->number) +
+                        ",\"timestamp_us\":" + std::to_string(frame->timestamp_us) + ",\"eyes\":[";
+        }
+        for (size_t i = 0; i < frame->eyes.size(); ++i) {
+            const cv::Rect& eye = frame->eyes[i];
+            cv::Point center(eye.x + eye.width / 2, eye.y + eye.height / 2);
+            if (!config.headless) {
+                cv::ellipse(frame->image, center, cv::Size(eye.width / 2, eye.height / 2), 0, 0, 360, cv::Scalar(255, 0, 0), 2);
+            }
+            if (!gaze_log && !publishing) {
+                continue;
+            }
+            if (publishing) {
+                gaze_json += (i ? ",{\"x\":" : "{\"x\":") + std::to_string(center.x) +
+                             ",\"y\":" + std::to_string(center.y) + ",\"regions\":[";
+            }
+
+            // One event per text region under the eye, or a single event if none
+            GazeEvent event{frame->timestamp_us, frame->number, center.x, center.y, GAZE_NO_REGION, GAZE_EYE_START};
+            region_index.query(center, [&](uint32_t id) {
+                if (publishing) {
+                    if (!(event.flags & GAZE_EYE_START)) {
+                        gaze_json += ',';
+                    }
+                    append_json_string(gaze_json, region_index.name(id));
+                }
+                event.region = id;
+                if (gaze_log) {
+                    gaze_log->append(event);
+                }
+                event.flags = 0;
+            });
+            if (gaze_log && (event.flags & GAZE_EYE_START)) {
+                gaze_log->append(event);
+            }
+            if (publishing) {
+                gaze_json += "]}";
+            }
+        }
+        if (publishing) {
+            gaze_json += "]}";
+            config.publish_gaze(gaze_json);
+        }
+
+        // One gaze point per face and frame, the midpoint of that face's eyes
+        face_sums.assign(frame->faces.size(), cv::Point(0, 0));
+        face_eyes.assign(frame->faces.size(), 0);
+        for (size_t i = 0; i < frame->eyes.size(); ++i) {
+            const cv::Rect& eye = frame->eyes[i];
+            uint32_t f = frame->eye_faces[i];
+            face_sums[f].x += eye.x + eye.width / 2;
+            face_sums[f].y += eye.y + eye.height / 2;
+            ++face_eyes[f];
+        }
+        for (auto it = aggregators.begin(); it != aggregators.end();) {
+            bool present = std::find(frame->face_ids.begin(), frame->face_ids.end(), it->first) != frame->face_ids.end();
+            if (!present) {
+                retire(*it->second);
+                it = aggregators.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (size_t f = 0; f < frame->faces.size(); ++f) {
+            if (face_eyes[f] == 0) {
+                continue;
+            }
+            std::unique_ptr<GazeAggregator>& aggregator = aggregators[frame->face_ids[f]];
+            if (!aggregator) {
+                aggregator = std::make_unique<GazeAggregator>(region_index, config.fixations);
+                if (config.on_fixation) {
+                    GazeAggregator* metrics = aggregator.get();
+                    metrics->on_fixation([&config, metrics](const Fixation& fixation) { config.on_fixation(fixation, *metrics); });
+                }
+            }
+            aggregator->add(frame->timestamp_us, cv::Point(face_sums[f].x / face_eyes[f], face_sums[f].y / face_eyes[f]),
+                            frame->image.size());
+        }
+
+        if (!config.headless) {
+            cv::imshow("Eye Tracking", frame->image);
+        }
+        pool->release(frame);
+        stats.sink.busy_ms += ms_since(start);
+        ++stats.sink.frames;
+        if (!config.headless && cv::waitKey(10) == 27) {  // Exit on 'ESC'
+            state.stop = true;
+        }
+    }
+
+    state.stop = true;
+    capture_thread.join();
+    detect_thread.join();
+    if (gaze_log) {
+        gaze_log->flush();
+    }
+    for (auto& entry : aggregators) {
+        retire(*entry.second);
+    }
+    stats.elapsed_s = ms_since(started) / 1000.0;
+    for (uint32_t id = 0; id < region_index.size(); ++id) {
+        stats.dwell_us[region_index.name(id)] = dwell_us[id];
+    }
+    if (stats_out) {
+        *stats_out = stats;
+    }
+    return true;
+}
@@ -0,0 +1,319 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+#include <iostream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Asynchronous keep-alive HTTP server for the reading page.
+//
+// Static pages are serialized once, headers included, into immutable
+// shared buffers. Serving a request is a lookup plus one async_write of the
+// shared bytes: no per-request response object, body copy or formatting.
+//
+// Live updates are pushed as Server-Sent Events. Each EventStream keeps
+// only its latest event, so a client that is still writing when several
+// updates arrive gets the newest one next and never builds a queue.
+
+namespace web {
+
+namespace asio = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+using tcp = asio::ip::tcp;
+
+#define WEB_SERVER_NAME "EyeTrackingServer"
+#define WEB_IDLE_TIMEOUT_SECONDS 30
+
+// Pre-serialized responses by request path. Filled before the server
+// starts and read-only afterwards, so lookups need no locking.
+class ResponseCache {
+public:
+    using Buffer = std::shared_ptr<const std::string>;
+
+    ResponseCache() {
+        not_found_ = {serialize(http::status::not_found, "text/plain", "Not found\n", true),
+                      serialize(http::status::not_found, "text/plain", "Not found\n", false)};
+    }
+
+    void add(const std::string& path, const std::string& content_type, const std::string& body) {
+        pages_[path] = {serialize(http::status::ok, content_type, body, true),
+                        serialize(http::status::ok, content_type, body, false)};
+    }
+
+    // Serialized response for `target`, ignoring any query string
+    Buffer find(beast::string_view target, bool keep_alive) const {
+        std::string path(target.substr(0, target.find('?')));
+        auto it = pages_.find(path);
+        const Entry& entry = it == pages_.end() ? not_found_ : it->second;
+        return keep_alive ? entry.keep_alive : entry.close;
+    }
+
+private:
+    struct Entry {
+        Buffer keep_alive;
+        Buffer close;
+    };
+
+    static Buffer serialize(http::status status, const std::string& content_type, const std::string& body, bool keep_alive) {
+        http::response<http::string_body> res{status, 11};
+        res.set(http::field::server, WEB_SERVER_NAME);
+        res.set(http::field::content_type, content_type);
+        res.keep_alive(keep_alive);
+        res.body() = body;
+        res.prepare_payload();
+        std::ostringstream out;
+        out << res;
+        return std::make_shared<const std::string>(out.str());
+    }
+
+    std::unordered_map<std::string, Entry> pages_;
+    Entry not_found_;
+};
+
+// Woken by an EventStream when an update arrives after it went idle
+class Subscriber {
+public:
+    virtual ~Subscriber() = default;
+    virtual void wake() = 0;
+};
+
+// Latest-value broadcast channel. publish() formats the event once into a
+// shared buffer and wakes idle subscribers with a single posted handler, so
+// the producer's cost per update does not depend on the number of clients.
+class EventStream : public std::enable_shared_from_this<EventStream> {
+public:
+    using Buffer = std::shared_ptr<const std::string>;
+
+    explicit EventStream(asio::io_context& ioc) : ioc_(ioc) {}
+
+    // Replaces the latest event; `data` must not contain blank lines
+    void publish(const std::string& data) {
+        auto event = std::make_shared<const std::string>("data: " + data + "\n\n");
+        bool notify = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            latest_ = std::move(event);
+            ++sequence_;
+            if (!idle_.empty() && !notify_pending_) {
+                notify_pending_ = notify = true;
+            }
+        }
+        if (notify) {
+            asio::post(ioc_, [self = shared_from_this()] { self->wake_idle(); });
+        }
+    }
+
+    // Returns the latest event if it is newer than `seen` and advances `seen`.
+    // Otherwise keeps `subscriber` alive until the next publish() wakes it.
+    Buffer next(uint64_t& seen, std::shared_ptr<Subscriber> subscriber) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (sequence_ > seen) {
+            seen = sequence_;
+            return latest_;
+        }
+        idle_.push_back(std::move(subscriber));
+        return nullptr;
+    }
+
+    // Drops idle subscribers; called once the server has stopped so their
+    // sockets close while the io_context still exists
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle_.clear();
+    }
+
+private:
+    void wake_idle() {
+        std::vector<std::shared_ptr<Subscriber>> idle;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            idle.swap(idle_);
+            notify_pending_ = false;
+        }
+        for (auto& subscriber : idle) {
+            subscriber->wake();
+        }
+    }
+
+    asio::io_context& ioc_;
+    std::mutex mutex_;
+    Buffer latest_;
+    uint64_t sequence_ = 0;
+    std::vector<std::shared_ptr<Subscriber>> idle_;
+    bool notify_pending_ = false;
+};
+
+// A client subscribed to an EventStream. Writes at most one event at a time;
+// whatever was published meanwhile collapses into the latest event.
+class StreamSession : public Subscriber, public std::enable_shared_from_this<StreamSession> {
+public:
+    StreamSession(beast::tcp_stream stream, std::shared_ptr<EventStream> events)
+        : stream_(std::move(stream)), events_(std::move(events)) {}
+
+    void start() {
+        static const std::string headers =
+            "HTTP/1.1 200 OK\r\n"
+            "Server: " WEB_SERVER_NAME "\r\n"
+            "Content-Type: text/event-stream\r\n"
+            "Cache-Control: no-cache\r\n"
+            "Connection: keep-alive\r\n\r\n";
+        stream_.expires_never();
+        asio::async_write(stream_, asio::buffer(headers), [self = shared_from_this()](beast::error_code ec, std::size_t) {
+            if (!ec) {
+                self->pump();
+            }
+        });
+    }
+
+    void wake() override {
+        asio::post(stream_.get_executor(), [self = shared_from_this()] { self->pump(); });
+    }
+
+private:
+    void pump() {
+        EventStream::Buffer event = events_->next(seen_, shared_from_this());
+        if (!event) {
+            return;  // Idle until the next publish()
+        }
+        asio::async_write(stream_, asio::buffer(*event), [self = shared_from_this(), event](beast::error_code ec, std::size_t) {
+            if (!ec) {
+                self->pump();
+            }
+        });
+    }
+
+    beast::tcp_stream stream_;
+    std::shared_ptr<EventStream> events_;
+    uint64_t seen_ = 0;
+};
+
+// What a server answers: cached pages plus event streams by path
+struct Routes {
+    ResponseCache cache;
+    std::unordered_map<std::string, std::shared_ptr<EventStream>> streams;
+
+    std::shared_ptr<EventStream> find_stream(beast::string_view target) const {
+        auto it = streams.find(std::string(target.substr(0, target.find('?'))));
+        return it == streams.end() ? nullptr : it->second;
+    }
+};
+
+// One client connection, reading requests until the client closes it, asks
+// for Connection: close or stays idle past the timeout
+class Session : public std::enable_shared_from_this<Session> {
+public:
+    Session(tcp::socket socket, const Routes& routes) : stream_(std::move(socket)), routes_(routes) {}
+
+    void start() {
+        read();
+    }
+
+private:
+    void read() {
+        request_ = {};
+        stream_.expires_after(std::chrono::seconds(WEB_IDLE_TIMEOUT_SECONDS));
+        http::async_read(stream_, buffer_, request_,
+                         [self = shared_from_this()](beast::error_code ec, std::size_t) { self->on_read(ec); });
+    }
+
+    void on_read(beast::error_code ec) {
+        if (ec) {
+            close();  // end_of_stream, timeout or a malformed request
+            return;
+        }
+        if (auto events = routes_.find_stream(request_.target())) {
+            // The connection now belongs to the event stream
+            std::make_shared<StreamSession>(std::move(stream_), std::move(events))->start();
+            return;
+        }
+        bool keep_alive = request_.keep_alive();
+        ResponseCache::Buffer response = routes_.cache.find(request_.target(), keep_alive);
+        // The lambda holds the shared buffer until the write completes
+        asio::async_write(stream_, asio::buffer(*response),
+                          [self = shared_from_this(), response, keep_alive](beast::error_code ec, std::size_t) {
+                              if (ec || !keep_alive) {
+                                  self->close();
+                                  return;
+                              }
+                              self->read();
+                          });
+    }
+
+    void close() {
+        beast::error_code ignored;
+        stream_.socket().shutdown(tcp::socket::shutdown_send, ignored);
+    }
+
+    beast::tcp_stream stream_;
+    beast::flat_buffer buffer_;
+    http::request<http::string_body> request_;
+    const Routes& routes_;
+};
+
+// Accepts on `port` and serves from `cache` on a pool of runner threads.
+// Each connection runs on its own strand.
+class WebServer {
+public:
+    WebServer(unsigned short port, ResponseCache cache, unsigned threads = std::thread::hardware_concurrency())
+        : threads_(threads ? threads : 1), ioc_(static_cast<int>(threads_)),
+          acceptor_(ioc_, tcp::endpoint(tcp::v4(), port)) {
+        routes_.cache = std::move(cache);
+    }
+
+    ~WebServer() {
+        stop();
+    }
+
+    // Serves Server-Sent Events at `path`. Must be called before start().
+    std::shared_ptr<EventStream> add_stream(const std::string& path) {
+        auto events = std::make_shared<EventStream>(ioc_);
+        routes_.streams[path] = events;
+        return events;
+    }
+
+    void start() {
+        accept();
+        for (unsigned i = 0; i < threads_; ++i) {
+            runners_.emplace_back([this] { ioc_.run(); });
+        }
+    }
+
+    void stop() {
+        ioc_.stop();
+        for (auto& runner : runners_) {
+            runner.join();
+        }
+        runners_.clear();
+        for (auto& stream : routes_.streams) {
+            stream.second->clear();
+        }
+    }
+
+    asio::io_context& context() { return ioc_; }
+
+private:
+    void accept() {
+        acceptor_.async_accept(asio::make_strand(ioc_), [this](beast::error_code ec, tcp::socket socket) {
+            if (!ec) {
+                std::make_shared<Session>(std::move(socket), routes_)->start();
+            }
+            accept();
+        });
+    }
+
+    Routes routes_;
+    unsigned threads_;
+    asio::io_context ioc_;
+    tcp::acceptor acceptor_;
+    std::vector<std::thread> runners_;
+};
+
+}  // namespace web
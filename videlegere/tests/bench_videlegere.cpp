@@ -0,0 +1,95 @@
+#include "../inc/tracker.hpp"
+
+#include <iostream>
+#include <map>
+#include <string>
+
+// Replays a recording through the tracker pipeline headless and reports
+// frames/sec and time per frame for each stage. Frames are never dropped,
+// so every run processes the same frames and results are comparable.
+//
+// Usage: bench_videlegere <video file | image directory> [--interval N]
+//                         [--log BASE] [--min-fps FPS] [--eye-workers N]
+//                         [--scale S] [--min-face PIXELS]
+//
+// --interval sets the full face detection interval (1 disables tracking),
+// --eye-workers the extra threads for per-face eye detection, --scale and
+// --min-face the downscaling and minimum face size of face detection,
+// --log enables the binary gaze log, and --min-fps makes the run fail below
+// the given rate so it can gate CI.
+
+// Word-sized regions tiling a 640x480 page, so region lookup has realistic work
+static std::map<std::string, TextRegion> benchmark_regions() {
+    std::map<std::string, TextRegion> regions;
+    int id = 0;
+    for (int y = 0; y + 20 <= 480; y += 24) {
+        for (int x = 0; x + 60 <= 640; x += 64) {
+            regions["word" + std::to_string(id++)] = {"word", cv::Rect(x, y, 60, 20)};
+        }
+    }
+    return regions;
+}
+
+static void print_stage(const char* name, const StageStats& stage) {
+    double per_frame = stage.frames ? stage.busy_ms / stage.frames : 0.0;
+    std::cout << name << ": " << stage.frames << " frames, " << per_frame << " ms/frame" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <video file | image directory> [--interval N] [--log BASE] [--min-fps FPS]"
+                  << " [--eye-workers N] [--scale S] [--min-face PIXELS]" << std::endl;
+        return 1;
+    }
+
+    TrackerConfig config;
+    config.source = argv[1];
+    config.headless = true;
+    config.drop_frames = false;
+    config.log_base.clear();
+    double min_fps = 0;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        if (flag == "--interval") {
+            config.tracker.redetect_interval = std::stoi(argv[i + 1]);
+        } else if (flag == "--log") {
+            config.log_base = argv[i + 1];
+        } else if (flag == "--min-fps") {
+            min_fps = std::stod(argv[i + 1]);
+        } else if (flag == "--eye-workers") {
+            int workers = std::stoi(argv[i + 1]);
+            if (workers < 0) {
+                std::cerr << "--eye-workers must be 0 or more" << std::endl;
+                return 1;
+            }
+            config.tracker.eye_workers = static_cast<unsigned>(workers);
+        } else if (flag == "--scale") {
+            config.tracker.detect_scale = std::stod(argv[i + 1]);
+        } else if (flag == "--min-face") {
+            config.tracker.min_face_size = std::stoi(argv[i + 1]);
+        } else {
+            std::cerr << "Unknown option " << flag << std::endl;
+            return 1;
+        }
+    }
+
+    TrackerStats stats;
+    if (!track_eyes(benchmark_regions(), config, &stats)) {
+        return 1;
+    }
+
+    double fps = stats.elapsed_s > 0 ? stats.sink.frames / stats.elapsed_s : 0.0;
+    std::cout << "source: " << config.source << ", interval: " << config.tracker.redetect_interval
+              << ", eye workers: " << config.tracker.eye_workers << ", scale: " << config.tracker.detect_scale << std::endl;
+    std::cout << "elapsed: " << stats.elapsed_s << " s, " << fps << " frames/sec" << std::endl;
+    print_stage("capture", stats.capture);
+    print_stage("detect", stats.detect);
+    print_stage("sink", stats.sink);
+    std::cout << "fixations: " << stats.fixations << ", saccades: " << stats.saccades << std::endl;
+
+    if (fps < min_fps) {
+        std::cerr << "Regression: " << fps << " frames/sec is below the minimum of " << min_fps << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,43 @@
+#include "../inc/gaze_log.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// Converts a binary gaze log back to the reading_log.txt text format.
+//
+// Usage: convert_gaze_log [log base] [output file]
+// The log base defaults to GAZE_LOG_BASE and output goes to stdout.
+int main(int argc, char** argv) {
+    std::string base = argc > 1 ? argv[1] : GAZE_LOG_BASE;
+
+    std::ofstream out_file;
+    if (argc > 2) {
+        out_file.open(argv[2], std::ios::trunc);
+        if (!out_file.is_open()) {
+            std::cerr << "Error: Could not open " << argv[2] << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = argc > 2 ? out_file : std::cout;
+
+    auto segments = gaze_log_segments(base);
+    if (segments.empty()) {
+        std::cerr << "Error: No gaze log segments found for " << base << std::endl;
+        return 1;
+    }
+
+    try {
+        for (const auto& segment : segments) {
+            GazeLogReader reader(segment.string());
+            GazeEvent event;
+            while (reader.next(event)) {
+                write_gaze_text(out, event, reader.regions());
+            }
+        }
+    } catch (std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
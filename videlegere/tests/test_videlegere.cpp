@@ -1,25 +1,22 @@
 #include <opencv2/opencv.hpp>
 #include <opencv2/objdetect.hpp>
-#include <boost/beast.hpp>
-#include <boost/asio.hpp>
-#include <fstream>
+#include <algorithm>
 #include <sstream>
 #include <string>
 #include <map>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "../inc/log_query.hpp"
+#include "../inc/tracker.hpp"
+#include "../inc/web_server.hpp"
 
 #define HOST_PORT 8080
-#define LOG_FILE "reading_log.txt"
+#define GAZE_STREAM_PATH "/gaze"
+#define READING_STREAM_PATH "/reading"
 
-using namespace boost;
 using namespace cv;
-using tcp = asio::ip::tcp;
-namespace http = beast::http;
-
-// Structure to represent text regions with coordinates
-struct TextRegion {
-    std::string text;
-    Rect bounding_box;  // x, y, width, height
-};
 
 // Function to host a basic webpage with lorem ipsum text and map text regions
 std::map<std::string, TextRegion> get_text_regions() {
@@ -32,108 +29,134 @@ std::map<std::string, TextRegion> get_text_regions() {
     return text_regions;
 }
 
-void run_web_server() {
-    try {
-        asio::io_context ioc;
-        tcp::acceptor acceptor(ioc, tcp::endpoint(tcp::v4(), HOST_PORT));
-        for (;;) {
-            tcp::socket socket(ioc);
-            acceptor.accept(socket);
-            std::string response_body = "<html><body><h1>Lorem Ipsum</h1><p>Lorem ipsum dolor sit amet, consectetur adipiscing elit...</p></body></html>";
-            http::response<http::string_body> res{http::status::ok, 11};
-            res.set(http::field::server, "EyeTrackingServer");
-            res.set(http::field::content_type, "text/html");
-            res.body() = response_body;
-            res.prepare_payload();
-            http::write(socket, res);
-        }
-    } catch (std::exception& e) {
-        std::cerr << "Error: " << e.what() << std::endl;
-    }
+// Pre-serialized pages for the web server, built once at startup
+web::ResponseCache make_page_cache() {
+    web::ResponseCache cache;
+    // Elements carry the region names so the page can highlight what is being read
+    cache.add("/", "text/html",
+              "<html><body><h1 id=\"title\">Lorem Ipsum</h1><p id=\"paragraph\">Lorem ipsum dolor sit amet, consectetur adipiscing elit...</p>"
+              "<script>"
+              "new EventSource('" GAZE_STREAM_PATH "').onmessage = function(e) {"
+              "  var read = {};"
+              "  JSON.parse(e.data).eyes.forEach(function(eye) { eye.regions.forEach(function(r) { read[r] = true; }); });"
+              "  document.querySelectorAll('[id]').forEach(function(el) { el.style.background = read[el.id] ? '#ffef9f' : ''; });"
+              "};"
+              "</script></body></html>");
+    return cache;
 }
 
-// Function to detect eyes and track gaze location
-void track_eyes(const std::map<std::string, TextRegion>& text_regions) {
-    CascadeClassifier face_cascade;
-    CascadeClassifier eyes_cascade;
-
-    // Load the pre-trained Haar Cascade classifiers for face and eyes
-    face_cascade.load("haarcascade_frontalface_default.xml");
-    eyes_cascade.load("haarcascade_eye.xml");
-
-    VideoCapture cap(0);  // Open default camera
-    if (!cap.isOpened()) {
-        std::cerr << "Error: Could not open webcam." << std::endl;
-        return;
-    }
-
-    Mat frame, gray;
-    std::ofstream log_file(LOG_FILE, std::ios::app);
-
-    while (true) {
-        cap >> frame;
-        if (frame.empty()) {
-            break;
-        }
-
-        cvtColor(frame, gray, COLOR_BGR2GRAY);
-        std::vector<Rect> faces;
-        face_cascade.detectMultiScale(gray, faces);
-
-        for (const auto& face : faces) {
-            Mat faceROI = gray(face);
-            std::vector<Rect> eyes;
-            eyes_cascade.detectMultiScale(faceROI, eyes);
-
-            for (const auto& eye : eyes) {
-                Point center(face.x + eye.x + eye.width / 2, face.y + eye.y + eye.height / 2);
-                ellipse(frame, center, Size(eye.width / 2, eye.height / 2), 0, 0, 360, Scalar(255, 0, 0), 2);
-                log_file << "Eye detected at: " << center.x << ", " << center.y << "\n";
-
-                // Compare eye coordinates with text region bounding boxes
-                for (const auto& region : text_regions) {
-                    if (region.second.bounding_box.contains(center)) {
-                        log_file << "Looking at text: " << region.second.text << "\n";
-                    }
-                }
-            }
-        }
+// Live reading metrics for one finished fixation: where it was, and the
+// total fixation time so far of the regions under it
+std::string fixation_json(const Fixation& fixation, const GazeAggregator& metrics) {
+    std::string json = "{\"start_us\":" + std::to_string(fixation.start_us) +
+                       ",\"duration_us\":" + std::to_string(fixation.end_us - fixation.start_us) +
+                       ",\"x\":" + std::to_string(fixation.center.x) + ",\"y\":" + std::to_string(fixation.center.y) +
+                       ",\"fixations\":" + std::to_string(metrics.fixation_count()) +
+                       ",\"saccades\":" + std::to_string(metrics.saccade_count()) + ",\"regions\":[";
+    bool first = true;
+    metrics.regions().query(fixation.center, [&](uint32_t id) {
+        json += first ? "{\"name\":" : ",{\"name\":";
+        append_json_string(json, metrics.regions().name(id));
+        json += ",\"dwell_us\":" + std::to_string(metrics.dwell_us(id)) + "}";
+        first = false;
+    });
+    json += "]}";
+    return json;
+}
 
-        imshow("Eye Tracking", frame);
-        if (waitKey(10) == 27) {  // Exit on 'ESC'
-            break;
+// The heatmap cells with the most fixation time, by their top-left pixel
+void print_hottest_cells(const TrackerStats& stats, int cell_px, size_t count = 5) {
+    std::vector<size_t> cells;
+    for (size_t i = 0; i < stats.heatmap.size(); ++i) {
+        if (stats.heatmap[i] > 0) {
+            cells.push_back(i);
         }
     }
-    log_file.close();
+    count = std::min(count, cells.size());
+    std::partial_sort(cells.begin(), cells.begin() + count, cells.end(),
+                      [&](size_t a, size_t b) { return stats.heatmap[a] > stats.heatmap[b]; });
+    for (size_t i = 0; i < count; ++i) {
+        size_t cell = cells[i];
+        std::cout << "heatmap cell at (" << cell % stats.heatmap_cols * cell_px << ", " << cell / stats.heatmap_cols * cell_px
+                  << "): " << stats.heatmap[cell] / 1e6 << " s" << std::endl;
+    }
 }
 
-// Function to retrieve logged data in a natural language format
+// Function to retrieve logged data in a natural language format. Answers
+// questions about a quoted passage, e.g. 'the book with the quote "..."',
+// from an index over the binary gaze log.
 void query_log(const std::string& query) {
-    std::ifstream log_file(LOG_FILE);
-    std::string line;
+    GazeLogFollower follower(GAZE_LOG_BASE);
+    follower.refresh();
+    const GazeLogIndex& index = follower.index();
     std::ostringstream response;
-    
-    if (query.find("quote") != std::string::npos) {
-        response << "You read a book containing the quote: \"Lorem ipsum dolor sit amet\"\n";
-    } else {
+
+    size_t open_quote = query.find('"');
+    size_t close_quote = open_quote == std::string::npos ? std::string::npos : query.find('"', open_quote + 1);
+    if (close_quote == std::string::npos) {
         response << "Query not understood.\n";
+        std::cout << response.str();
+        return;
+    }
+
+    std::string phrase = query.substr(open_quote + 1, close_quote - open_quote - 1);
+    bool found = false;
+    for (uint32_t region : index.regions_containing(phrase)) {
+        std::vector<ReadInterval> reads = index.intervals(region);
+        if (reads.empty()) {
+            continue;
+        }
+        found = true;
+        double seconds = index.dwell_us(region, 0, UINT64_MAX) / 1e6;
+        response << "You read a passage containing the quote \"" << phrase << "\": \"" << index.text(region) << "\" ("
+                 << index.name(region) << "), " << reads.size() << " time(s) for " << seconds << " s, last on "
+                 << format_timestamp(reads.back().start_us) << "\n";
+    }
+    if (!found) {
+        response << "You have not read anything containing the quote \"" << phrase << "\"\n";
     }
 
     std::cout << response.str();
 }
 
-int main() {
-    // Run the web server in a separate thread
-    std::thread web_server_thread(run_web_server);
+// Usage: test_videlegere [source] [--headless]
+// The source is a camera index (default 0), a video file or an image directory.
+int main(int argc, char** argv) {
+    TrackerConfig config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--headless") {
+            config.headless = true;
+        } else {
+            config.source = arg;
+        }
+    }
+
+    // Serve the reading page from a pool of runner threads, with live gaze
+    // updates pushed to it as Server-Sent Events
+    web::WebServer web_server(HOST_PORT, make_page_cache());
+    std::shared_ptr<web::EventStream> gaze_stream = web_server.add_stream(GAZE_STREAM_PATH);
+    std::shared_ptr<web::EventStream> reading_stream = web_server.add_stream(READING_STREAM_PATH);
+    config.publish_gaze = [gaze_stream](const std::string& json) { gaze_stream->publish(json); };
+    config.on_fixation = [reading_stream](const Fixation& fixation, const GazeAggregator& metrics) {
+        reading_stream->publish(fixation_json(fixation, metrics));
+    };
+    web_server.start();
 
     // Get text regions for mapping
     std::map<std::string, TextRegion> text_regions = get_text_regions();
 
     // Track eyes in the main thread, with text region mapping
-    track_eyes(text_regions);
+    TrackerStats stats;
+    if (track_eyes(text_regions, config, &stats)) {
+        std::cout << stats.fixations << " fixations, " << stats.saccades << " saccades" << std::endl;
+        for (const auto& region : stats.dwell_us) {
+            std::cout << region.first << ": " << region.second / 1e6 << " s" << std::endl;
+        }
+        print_hottest_cells(stats, config.fixations.heatmap_cell_px);
+    }
 
-    // Join the web server thread
-    web_server_thread.join();
+    web_server.stop();
 
     // Example of querying the log
     query_log("What was the book that I read with the quote \"Lorem ipsum dolor sit amet\"?");